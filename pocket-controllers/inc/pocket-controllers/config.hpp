@@ -21,6 +21,7 @@
 
 #include "pocket/globals.hpp"
 #include "pocket-pods/device.hpp"
+#include "pocket-services/database.hpp"
 
 
 namespace pocket::controllers::inline v5
@@ -36,7 +37,7 @@ public:
     explicit config(const std::optional<std::string>& config_path = {});
     POCKET_NO_COPY_NO_MOVE(config)
 
-    std::tuple<pods::device, std::string, std::string> parse(const std::string_view& config_json);
+    std::tuple<pods::device, std::string, std::string, services::database::open_options> parse(const std::string_view& config_json);
 
     inline std::string get_config_path() const noexcept
     {
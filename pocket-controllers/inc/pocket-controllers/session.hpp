@@ -58,6 +58,7 @@ class session final
     std::string secret;
     std::string aes_cbc_iv;
     std::string cors_header_token;
+    services::database::open_options open_options;
     pods::device::opt device;
 
     const services::synchronizer::stat* status = nullptr;
@@ -106,6 +107,11 @@ public:
         return *status;
     }
     
+    inline const services::database::ptr& get_database() const noexcept
+    {
+        return database;
+    }
+
     inline const views::view<pods::group>::ptr& get_view_group() const noexcept
     {
         return view_group;
@@ -152,7 +158,7 @@ public:
         return timestamp_last_update;
     }
 private:
-    void export_data(nlohmann::json& json, const daos::dao& dao, const services::aes& aes, const pods::group::ptr& group, bool enable_aes) const;
+    void export_data(nlohmann::json& json, const daos::subtree& tree, const services::aes& aes, const pods::group::ptr& group, bool enable_aes) const;
 
     void import_data(const pods::user::ptr& user, nlohmann::json& json_group, const daos::dao& dao, const services::aes& aes, std::optional<pods::group*> father, bool enable_aes) const;
 
@@ -162,8 +168,6 @@ private:
 
     void import_data_legacy_field(const pods::user::ptr& user, const daos::dao &dao, const tinyxml2::XMLElement *element, const services::aes& aes, const pods::group::ptr &father, bool enable_aes) const;
 
-    void copy(const daos::dao& dao, const pods::group::ptr& group, int64_t father_group_id, int64_t father_server_group_id, bool move) const;
-    
     void lock();
 
     void unlock();
@@ -32,6 +32,8 @@ using pods::device;
 using services::json_to_device;
 using services::json_to_aes_cbc_iv;
 using services::json_to_cors_header_token;
+using services::json_to_open_options;
+using services::database;
 using nlohmann::json;
 using namespace std;
 using namespace std::filesystem;
@@ -83,11 +85,12 @@ catch (const nlohmann::detail::parse_error& e)
     throw runtime_error(e.what());
 }
 
-tuple<device, string, string> config::parse(const string_view& config_json) try
+tuple<device, string, string, database::open_options> config::parse(const string_view& config_json) try
 {
     auto&& device = json_to_device(config_json);
     auto&&aes_cbc_iv = json_to_aes_cbc_iv(config_json);
     auto&&cors_header_token = json_to_cors_header_token(config_json);
+    auto&&open_options = json_to_open_options(config_json);
 
     if(device.user_id == 0)
     {
@@ -106,7 +109,7 @@ tuple<device, string, string> config::parse(const string_view& config_json) try
 
     debug(typeid(*this).name(), "Create new config");
 
-    return {device, aes_cbc_iv, cors_header_token};
+    return {device, aes_cbc_iv, cors_header_token, open_options};
 }
 catch (const runtime_error& e)
 {
@@ -60,10 +60,11 @@ session::session(const optional<string>& config_json, const optional<string>& co
     
     this->config = make_unique<class config>(config_path);
 
-    auto&& [device, aes_cbc_iv, auth_header] = config->parse(*config_json);
+    auto&& [device, aes_cbc_iv, auth_header, open_options] = config->parse(*config_json);
     this->device = std::move(device);
     this->aes_cbc_iv = std::move(aes_cbc_iv);
     this->cors_header_token = std::move(auth_header);
+    this->open_options = std::move(open_options);
 
     if(check_lock())
     {
@@ -109,7 +110,7 @@ const device::opt& session::init()
     database = make_unique<class database>();
 
     uint8_t attempts = 10;
-    while(!database->open(file_db_path) && attempts > 0)
+    while(!database->open(file_db_path, open_options) && attempts > 0)
     {
         this_thread::sleep_for(chrono::milliseconds(10));
         attempts--;
@@ -120,6 +121,9 @@ const device::opt& session::init()
         throw runtime_error("Database busy");
     }
 
+    // Keep the WAL and the free pages of soft deleted rows in check off the hot path
+    database->start_maintenance();
+
     synchronizer = make_unique<class synchronizer>(database, secret, *device, cors_header_token);
     status = synchronizer->get_status();
     return device;
@@ -154,6 +158,8 @@ optional<user::ptr> session::login(const string& email, const string& passwd, bo
 
 optional<user::ptr> session::retrieve_data(const optional<user::ptr>& user_opt, bool enable_aes) try
 {
+    database::io_tag tag("session.retrieve_data");
+
     if(!user_opt)
     {
         error(typeid(this).name(), "user empty");
@@ -528,6 +534,8 @@ bool session::invalidate(const pods::user::opt_ptr& user_opt)
 
 bool session::export_data(const optional<user::ptr>& user_opt, string full_path_file, bool enable_aes)
 {
+    database::io_tag tag("session.export_data");
+
     if(full_path_file.empty())
     {
         return false;
@@ -565,11 +573,12 @@ bool session::export_data(const optional<user::ptr>& user_opt, string full_path_
 
     nlohmann::json json;
     daos::dao dao{database};
-    auto aes = services::aes(aes_cbc_iv, user->passwd);
+    auto aes = services::aes(aes_cbc_iv, user->passwd, database->is_ciphertext_raw());
 
-    for(auto& group : dao.get_all<group>(0))
+    auto&& vault = dao.get_subtree(0);
+    for(auto& group : vault.children<group>(0))
     {
-        export_data(json, dao, aes, group, enable_aes);
+        export_data(json, vault, aes, group, enable_aes);
     }
 
     ofstream file(full_path_file);
@@ -592,6 +601,8 @@ bool session::export_data(const optional<user::ptr>& user_opt, string full_path_
 
 bool session::import_data(const pods::user::opt_ptr& user_opt, string full_path_file, bool enable_aes)
 {
+    database::io_tag tag("session.import_data");
+
     if(full_path_file.starts_with("file://"))
     {
         full_path_file = &full_path_file[7];
@@ -630,7 +641,7 @@ bool session::import_data(const pods::user::opt_ptr& user_opt, string full_path_
     }
 
     daos::dao dao{database};
-    auto aes = services::aes(aes_cbc_iv, user->passwd);
+    auto aes = services::aes(aes_cbc_iv, user->passwd, database->is_ciphertext_raw());
 
     json data = json::parse(ifstream(full_path_file));
 
@@ -639,6 +650,8 @@ bool session::import_data(const pods::user::opt_ptr& user_opt, string full_path_
         return false;
     }
 
+    database::transaction transaction(*database);
+
     dao.del_all<field>();
     dao.del_all<group_field>();
     dao.del_all<group>();
@@ -648,6 +661,8 @@ bool session::import_data(const pods::user::opt_ptr& user_opt, string full_path_
         import_data(user, json_group, dao, aes, nullopt, enable_aes);
     }
 
+    transaction.commit();
+
     return true;
 }
 
@@ -690,7 +705,7 @@ bool session::import_data_legacy(const pods::user::opt_ptr& user_opt, std::strin
     }
 
     daos::dao dao{database};
-    auto aes = services::aes(aes_cbc_iv, user->passwd);
+    auto aes = services::aes(aes_cbc_iv, user->passwd, database->is_ciphertext_raw());
 
 
     XMLDocument document;
@@ -701,6 +716,8 @@ bool session::import_data_legacy(const pods::user::opt_ptr& user_opt, std::strin
         throw runtime_error(document.ErrorStr());
     }
 
+    database::transaction transaction(*database);
+
     dao.del_all<field>();
     dao.del_all<group_field>();
     dao.del_all<group>();
@@ -719,6 +736,8 @@ bool session::import_data_legacy(const pods::user::opt_ptr& user_opt, std::strin
         element = element->NextSiblingElement();
     }
 
+    transaction.commit();
+
     return true;
 }
 
@@ -750,17 +769,7 @@ bool session::copy_group(const pods::user::opt_ptr& user_opt, int64_t group_id_s
     }
 
     daos::dao dao{database};
-    
-    
-    auto&& group_src = dao.get<class group>(group_id_src);
-    auto&& group_dst = dao.get<class group>(group_id_dst);
-    if(group_src && group_dst)
-    {
-        copy(dao, *group_src, group_dst.value()->id, group_dst.value()->server_id,  move);
-        return true;
-    }
-    
-    return false;
+    return dao.clone_subtree(group_id_src, group_id_dst, move) != daos::dao::NO_ID;
 }
 
 bool session::copy_field(const pods::user::opt_ptr& user_opt, int64_t field_id_src,  int64_t group_id_dst, bool move)
@@ -791,30 +800,7 @@ bool session::copy_field(const pods::user::opt_ptr& user_opt, int64_t field_id_s
     }
 
     daos::dao dao{database};
-    auto aes = services::aes(aes_cbc_iv, user->passwd);
-        
-    auto&& field_src = dao.get<class field>(field_id_src);
-    auto&& group_dst = dao.get<class group>(group_id_dst);
-    if(field_src && group_dst)
-    {
-        auto field = make_unique<class field>(*field_src.value());
-        auto field_id = field->id;
-        field->id = 0;
-        field->server_id = 0;
-        field->group_id = group_dst.value()->id;
-        field->server_group_id = group_dst.value()->server_id;
-        field->timestamp_creation = get_current_time_GMT();
-        field->synchronized = false;
-        dao.persist<class field>(field, false);
-        if(move)
-        {
-            dao.del<class field>(field_id);
-        }
-        
-        return true;
-    }
-    
-    return true;
+    return dao.clone_field(field_id_src, group_id_dst, move) != daos::dao::NO_ID;
 }
 
 bool session::heartbeat(const pods::user::opt_ptr& user_opt)
@@ -847,26 +833,28 @@ bool session::heartbeat(const pods::user::opt_ptr& user_opt)
     return synchronizer->heartbeat(user, timestamp_last_update);
 }
 
-void session::export_data(json& json, const daos::dao& dao, const services::aes& aes, const pods::group::ptr& group, bool enable_aes) const
+void session::export_data(json& json, const daos::subtree& tree, const services::aes& aes, const pods::group::ptr& group, bool enable_aes) const
 {
     if(group->deleted)
     {
         return;
     }
+    // Without aes the ciphertext is exported as stored: raw bytes are base64 in the JSON, as on the wire
+    const bool raw_ciphertext = !enable_aes && database->is_ciphertext_raw();
     if(enable_aes)
     {
         group->title = aes.decrypt(group->title);
         group->note = aes.decrypt(group->note);
         group->icon = aes.decrypt(group->icon);
     }
-    auto json_group = serialize_json(group, true);
+    auto json_group = serialize_json(group, true, raw_ciphertext);
 
-    for(const auto& g : dao.get_all<struct group>(group->id))
+    for(const auto& g : tree.children<struct group>(group->id))
     {
-        export_data(json_group, dao, aes, g, enable_aes);
+        export_data(json_group, tree, aes, g, enable_aes);
     }
 
-    for(const auto& gf : dao.get_all<group_field>(group->id))
+    for(const auto& gf : tree.children<group_field>(group->id))
     {
         if(gf->deleted)
         {
@@ -876,10 +864,10 @@ void session::export_data(json& json, const daos::dao& dao, const services::aes&
         {
             gf->title = aes.decrypt(gf->title);
         }
-        json_group["groupFields"].push_back(serialize_json(gf, true));
+        json_group["groupFields"].push_back(serialize_json(gf, true, raw_ciphertext));
     }
 
-    for(const auto& f : dao.get_all<field>(group->id))
+    for(const auto& f : tree.children<field>(group->id))
     {
         if(f->deleted)
         {
@@ -890,7 +878,7 @@ void session::export_data(json& json, const daos::dao& dao, const services::aes&
             f->title = aes.decrypt(f->title);
             f->value = aes.decrypt(f->value);
         }
-        json_group["fields"].push_back(serialize_json(f, true));
+        json_group["fields"].push_back(serialize_json(f, true, raw_ciphertext));
     }
 
     json["groups"].push_back(json_group);
@@ -898,7 +886,8 @@ void session::export_data(json& json, const daos::dao& dao, const services::aes&
 
 void session::import_data(const pods::user::ptr& user, nlohmann::json& json_group, const daos::dao& dao, const services::aes& aes, std::optional<pods::group*> father, bool enable_aes) const
 {
-    auto&& g = json_to_group(json_group, true);
+    const bool raw_ciphertext = !enable_aes && database->is_ciphertext_raw();
+    auto&& g = json_to_group(json_group, true, raw_ciphertext);
     if(g.deleted)
     {
         return;
@@ -919,9 +908,10 @@ void session::import_data(const pods::user::ptr& user, nlohmann::json& json_grou
 
     if(!json_group["groupFields"].is_null() &&  json_group["groupFields"].is_array())
     {
+        daos::dao::list<group_field> group_fields;
         for(auto&& json_group_field : json_group["groupFields"])
         {
-            auto&& gf = json_to_group_field(json_group_field, true);
+            auto&& gf = json_to_group_field(json_group_field, true, raw_ciphertext);
             if(gf.deleted)
             {
                 continue;
@@ -933,15 +923,17 @@ void session::import_data(const pods::user::ptr& user, nlohmann::json& json_grou
             gf.group_id = g.id;
             gf.user_id = user->id;
             gf.synchronized = false;
-            gf.id = dao.persist<group_field>(make_unique<group_field>(gf), false);
+            group_fields.push_back(make_unique<group_field>(gf));
         }
+        dao.persist_all<group_field>(group_fields);
     }
 
     if(!json_group["fields"].is_null() && json_group["fields"].is_array())
     {
+        daos::dao::list<field> fields;
         for(auto&& json_field: json_group["fields"])
         {
-            auto&& f = json_to_field(json_field, true);
+            auto&& f = json_to_field(json_field, true, raw_ciphertext);
             if(f.deleted)
             {
                 continue;
@@ -953,9 +945,9 @@ void session::import_data(const pods::user::ptr& user, nlohmann::json& json_grou
             f.group_id = g.id;
             f.user_id = user->id;
             f.synchronized = false;
-            f.id = dao.persist<field>(make_unique<field>(f), false);
-
+            fields.push_back(make_unique<field>(f));
         }
+        dao.persist_all<field>(fields);
     }
 
     if(!json_group["groups"].is_null() && json_group["groups"].is_array())
@@ -1089,82 +1081,6 @@ void session::import_data_legacy_field(const pods::user::ptr& user, const daos::
     dao.persist<struct field>(field);
 }
 
-void session::copy(const daos::dao& dao, const pods::group::ptr& group, int64_t father_group_id, int64_t father_server_group_id, bool move) const
-{
-    if(group->deleted)
-    {
-        return;
-    }
-    
-    auto group_id = group->id;
-    group->id = 0;
-    group->server_id = 0;
-    group->group_id = father_group_id;
-    group->server_group_id = father_server_group_id;
-    group->synchronized = false;
-    group->timestamp_creation = get_current_time_GMT();
-    group->id = dao.persist<class group>(group, false);
-    if(move)
-    {
-        dao.del<class group>(group_id);
-    }
-    
-    
-    map<int64_t, int64_t> map_id_src_id_dst;
-    vector<int64_t> src_server_ids;
-    for(auto&& group_field : dao.get_all<class group_field>(group_id))
-    {
-        auto group_field_id_src = group_field->id;
-        src_server_ids.push_back(group_field->server_id);
-        group_field->id = 0;
-        group_field->server_id = 0;
-        group_field->group_id = group->id;
-        group_field->server_group_id = 0;
-        group_field->timestamp_creation = get_current_time_GMT();
-        group_field->synchronized = false;
-        group_field->id = dao.persist<class group_field>(group_field, false);
-        map_id_src_id_dst[group_field_id_src] = group_field->id;
-        if(move)
-        {
-            dao.del<class group_field>(group_field_id_src);
-        }
-    }
-    
-    for(auto&& field : dao.get_all<class field>(group_id))
-    {
-        auto field_id_src = field->id;
-        field->id = 0;
-        field->server_id = 0;
-        field->group_id = group->id;
-        field->server_group_id = 0;
-        if(map_id_src_id_dst.contains(field->server_id))
-        {
-            field->group_field_id = map_id_src_id_dst[field->server_id];
-
-            auto it = find_if(src_server_ids.begin(), src_server_ids.end(), [server_group_field_id = field->server_group_field_id](int id) {
-                return server_group_field_id == id;
-            });
-            if (it != src_server_ids.end())
-            {
-                field->server_group_field_id = *it;
-            }
-        }
-        field->timestamp_creation = get_current_time_GMT();
-        field->synchronized = false;
-        field->id = dao.persist<class field>(field, false);
-        if(move)
-        {
-            dao.del<class field>(field_id_src);
-        }
-    }
-    
-    for(auto&& it : dao.get_all<class group>(group_id))
-    {
-        copy(dao, it, group->id, 0, move);
-    }
-}
-
-    
 void session::lock()
 {
 #ifndef POCKET_DISABLE_LOCK
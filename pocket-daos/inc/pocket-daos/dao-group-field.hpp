@@ -1,33 +0,0 @@
-/***************************************************************************
- *
- * Pocket
- * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
- *
- * This program is free software: you can redistribute it and/or modify
- * it under the terms of the GNU General Public License as published by
- * the Free Software Foundation, either version 3 of the License
- *
- * This program is distributed in the hope that it will be useful,
- * but WITHOUT ANY WARRANTY; without even the implied warranty of
- * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
- * GNU General Public License for more details.
- *
- * You should have received a copy of the GNU General Public License
- * along with this program.  If not, see <http://www.gnu.org/licenses/>.
- *
- ***************************************************************************/
-
-#pragma once
-
-#include "pocket-daos/dao.hpp"
-#include "pocket-pods/group-field.hpp"
-
-namespace pocket::daos::inline v5
-{
-
-// int64_t persist_private(dao* dao, const pods::group_field::ptr& t, bool return_rows_modified);
-
-template<>
-int64_t dao::get_last_id<pods::group_field>() const;
-
-}
@@ -21,32 +21,112 @@
 
 #include "pocket/globals.hpp"
 #include "pocket-services/database.hpp"
+#include "pocket-services/cursor.hpp"
 #include "pocket-iface/read-write.hpp"
+#include "pocket-daos/table-descriptor.hpp"
 
-
-#include <stdexcept>
+#include <string>
+#include <type_traits>
 
 namespace pocket::daos::inline v5
 {
 
-
+// Rows of T decoded and bound column by column from table_descriptor<T>
 template<iface::require_pod T>
 class dao_read_write final : public iface::read_write<services::database::row, services::database::parameters, T>
 {
+    bool raw_ciphertext = false;
+
 public:
     dao_read_write() = default;
+
+    // raw_ciphertext: bind the CIPHERTEXT columns as BLOB, see database::ciphertext_storage
+    explicit dao_read_write(bool raw_ciphertext) noexcept
+    : raw_ciphertext(raw_ciphertext)
+    {}
     ~dao_read_write() override = default;
     POCKET_NO_COPY_NO_MOVE(dao_read_write)
 
     T::ptr read(services::database::row& row) override
     {
-        throw std::runtime_error("Not implemented");
+        auto ret = std::make_unique<T>();
+        for_each_column<T>([&](auto&& column, size_t)
+        {
+            auto&& value = row[column.name];
+            if constexpr(is_text_column<decltype(column)>)
+            {
+                (*ret).*column.member = value.to_text();
+            }
+            else
+            {
+                (*ret).*column.member = static_cast<typename std::remove_cvref_t<decltype(column)>::member_type>(value.to_integer());
+            }
+        });
+        return ret;
+    }
+
+    // By ordinal when the statement lists the columns as table_sql<T>::select, by name otherwise
+    T::ptr read(const services::cursor& cursor)
+    {
+        auto ret = std::make_unique<T>();
+        for_each_column<T>([&](auto&& column, size_t ordinal)
+        {
+            auto i = static_cast<int>(ordinal);
+            if(i >= cursor.column_count() || cursor.column_name(i) != column.name)
+            {
+                i = cursor.column_index(column.name);
+            }
+            if(i < 0)
+            {
+                // Not selected, left at its default
+                return;
+            }
+
+            if constexpr(is_text_column<decltype(column)>)
+            {
+                (*ret).*column.member = cursor.get_text(i);
+            }
+            else
+            {
+                (*ret).*column.member = static_cast<typename std::remove_cvref_t<decltype(column)>::member_type>(cursor.get_integer(i));
+            }
+        });
+        return ret;
     }
 
+    // Every column but id in descriptor order, then id when not 0: the parameters of table_sql<T>::insert and update.
+    // Text is borrowed from t, that must outlive the statement
     services::database::parameters write(const T::ptr& t) override
     {
-        throw std::runtime_error("Not implemented");
+        if(t.get() == nullptr)
+        {
+            return {};
+        }
+
+        services::database::parameters ret;
+        for_each_column<T>([&](auto&& column, size_t ordinal)
+        {
+            if(ordinal == 0)
+            {
+                return;
+            }
+
+            auto&& value = (*t).*column.member;
+            if constexpr(is_text_column<decltype(column)>)
+            {
+                ret.push_back(raw_ciphertext && column.type == column_type::CIPHERTEXT ? pods::variant::blob_view(value) : pods::variant::view(value));
+            }
+            else
+            {
+                ret.emplace_back(static_cast<int64_t>(value));
+            }
+        });
+        if(t->id)
+        {
+            ret.emplace_back(t->id);
+        }
+        return ret;
     }
 };
 
-}
\ No newline at end of file
+}
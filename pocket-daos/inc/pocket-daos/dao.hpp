@@ -23,115 +23,60 @@
 #include "pocket-services/database.hpp"
 #include "pocket-services/result-set.hpp"
 #include "pocket-iface/pod.hpp"
-#include "pocket-daos/dao-read-write-group.hpp"
-#include "pocket-daos/dao-read-write-group-field.hpp"
-#include "pocket-daos/dao-read-write-field.hpp"
+#include "pocket-daos/storage.hpp"
+#include "pocket-daos/sqlite-storage.hpp"
 #include "pocket-pods/helpers.hpp"
 
+#include <span>
 #include <vector>
 
 namespace pocket::daos::inline v5
 {
 
-class dao;
-int64_t persist_private(dao* dao, const pods::field::ptr& t, bool return_rows_modified);
-int64_t persist_private(dao* dao, const pods::group_field::ptr& t, bool return_rows_modified);
-int64_t persist_private(dao* dao, const pods::group::ptr& t, bool return_rows_modified);
-
+// Pod access on a storage backend: the SQLite database of the session, or any other storage like memory_storage
 class dao final
 {
-    services::database::ptr&database;
-    friend int64_t persist_private(dao* dao, const pods::field::ptr& t, bool return_rows_modified);
-    friend int64_t persist_private(dao* dao, const pods::group_field::ptr& t, bool return_rows_modified);
-    friend int64_t persist_private(dao* dao, const pods::group::ptr& t, bool return_rows_modified);
-
+    storage::ptr owned; // backend built by the database constructor
+    storage& backend;
 public:
     template<iface::require_pod T>
     using list = std::vector<typename iface::pod<T>::ptr>;
 
-    static constexpr int64_t NO_ID = -1;
+    static constexpr int64_t NO_ID = storage::NO_ID;
 
-    explicit dao(services::database::ptr& database) noexcept
-    : database(database)
+    explicit dao(services::database::ptr& database)
+    : owned(std::make_unique<sqlite_storage>(database))
+    , backend(*owned)
+    {}
+
+    explicit dao(storage& backend) noexcept
+    : backend(backend)
     {}
     POCKET_NO_COPY_NO_MOVE(dao)
     ~dao() = default;
 
     template<iface::require_pod T>
-    std::optional<typename T::ptr> get(int64_t id) const
-    {
-        if(auto&& opt_rs = database->execute("SELECT * FROM " + T::get_name() + " WHERE id = ?", {id} ); opt_rs) //throw exception
-        {
-            for(auto&& row : **opt_rs)
-            {
-                if constexpr (std::is_same_v<T, pods::group>)
-                {
-                    dao_read_write<pods::group> dao;
-                    if(auto&& it = dao.read(row); it.get())
-                    {
-                        return it;
-                    }
-                }
-                else if constexpr (std::is_same_v<T, pods::group_field>)
-                {
-                    dao_read_write<pods::group_field> dao;
-                    if(auto&& it = dao.read(row); it.get())
-                    {
-                        return std::move(it);
-                    }
-                }
-                else if constexpr (std::is_same_v<T, pods::field>)
-                {
-                    dao_read_write<pods::field> dao;
-                    if(auto&& it = dao.read(row); it.get())
-                    {
-                        return std::move(it);
-                    }
-                }
-            }
-        }
-
-        return std::nullopt;
-    }
-
-    template<iface::require_pod T>
-    list<T> get_all(int64_t group_id = -1, bool to_synch = false) const
-    {
-        std::vector<typename iface::pod<T>::ptr> ret;
-
-
-        if(auto&& opt_rs = database->execute("SELECT * FROM " + T::get_name() + (to_synch ? " WHERE synchronized = 0" : (group_id < 0 ? " WHERE deleted = 0" : " WHERE deleted = 0 AND group_id = " + std::to_string(group_id))) + " ORDER BY group_id, id"); opt_rs) //throw exception
-        {
-            for(auto&& row : **opt_rs)
-            {
-                if constexpr (std::is_same_v<T, pods::group>)
-                {
-                    dao_read_write<pods::group> dao;
-                    if(auto&& it = dao.read(row); it.get())
-                    {
-                        ret.push_back(std::move(it));
-                    }
-                }
-                else if constexpr (std::is_same_v<T, pods::group_field>)
-                {
-                    dao_read_write<pods::group_field> dao;
-                    if(auto&& it = dao.read(row); it.get())
-                    {
-                        ret.push_back(std::move(it));
-                    }
-                }
-                else if constexpr (std::is_same_v<T, pods::field>)
-                {
-                    dao_read_write<pods::field> dao;
-                    if(auto&& it = dao.read(row); it.get())
-                    {
-                        ret.push_back(std::move(it));
-                    }
-                }
-            }
-        }
-
-        return ret;
+    inline std::optional<typename T::ptr> get(int64_t id) const
+    {
+        return backend.table<T>().get(id);
+    }
+
+    template<iface::require_pod T>
+    inline std::optional<typename T::ptr> get_by_server_id(int64_t server_id) const
+    {
+        return backend.table<T>().get_by_server_id(server_id);
+    }
+
+    template<iface::require_pod T>
+    inline list<T> get_all(int64_t group_id = -1, bool to_synch = false) const
+    {
+        return backend.table<T>().get_all(group_id, to_synch);
+    }
+
+    template<iface::require_pod T>
+    inline list<T> get_list(int64_t group_id, std::string_view search = {}, size_t limit = 0, size_t offset = 0, bool decrypt = false) const
+    {
+        return backend.table<T>().get_list(group_id, search, limit, offset, decrypt);
     }
 
     void update_all_index(const pods::net_helper& net_helper) const;
@@ -139,7 +84,7 @@ public:
     template<iface::require_pod T>
     inline int64_t del(int64_t id) const
     {
-        return database->update("UPDATE " + T::get_name() + " SET deleted = 1, synchronized = 0 WHERE id = ?", { {id} });
+        return backend.table<T>().del(id);
     }
 
     template<iface::require_pod T>
@@ -151,13 +96,13 @@ public:
     template<iface::require_pod T>
     inline int64_t del_all() const
     {
-        return database->update("UPDATE " + T::get_name() + " SET deleted = 1, synchronized = 0");
+        return backend.table<T>().del_all();
     }
     
     template<iface::require_pod T>
     inline int64_t del_by_group_id(int64_t id) const
     {
-        return database->update("UPDATE " + T::get_name() + " SET deleted = 1, synchronized = 0 WHERE group_id = ?", { {id} });
+        return backend.table<T>().del_by_group_id(id);
     }
 
     template<iface::require_pod T>
@@ -169,7 +114,7 @@ public:
     template<iface::require_pod T>
     inline int64_t rm(int64_t id) const
     {
-        return database->update("DELETE FROM " + T::get_name() + " WHERE id = ?", { {id} });
+        return backend.table<T>().rm(id);
     }
 
     template<iface::require_pod T>
@@ -181,7 +126,7 @@ public:
     template<iface::require_pod T>
     inline int64_t rm_all() const
     {
-        return database->update("DELETE FROM " + T::get_name());
+        return backend.table<T>().rm_all();
     }
     
     template<iface::require_pod T>
@@ -193,32 +138,49 @@ public:
     template<iface::require_pod T>
     inline int64_t rm_by_group_id(int64_t group_id) const
     {
-        return database->update("DELETE FROM " + T::get_name() + " WHERE deleted = 1 AND group_id = ?", { {group_id} });
+        return backend.table<T>().rm_by_group_id(group_id);
     }
     
     template<iface::require_pod T>
-    int64_t persist(const T::ptr& t, bool return_rows_modified = true) const
+    inline int64_t persist(const T::ptr& t, bool return_rows_modified = true) const
     {
-        return persist_private(t, return_rows_modified);
+        return backend.table<T>().persist(t, return_rows_modified);
     }
 
+    // Bulk insert or update, see iface::table_storage::persist_all
     template<iface::require_pod T>
-    int64_t get_last_id() const { return NO_ID; };
-private:
-    int64_t get_last_inserted_id() const
+    inline std::vector<int64_t> persist_all(std::span<const typename T::ptr> rows) const
+    {
+        return backend.table<T>().persist_all(rows);
+    }
+
+    template<iface::require_pod T>
+    inline int64_t get_last_id() const
+    {
+        return backend.table<T>().get_last_id();
+    }
+
+    // Groups, group fields and fields below root_group_id in a few queries, see storage::get_subtree
+    inline subtree get_subtree(int64_t root_group_id) const
+    {
+        return backend.get_subtree(root_group_id);
+    }
+
+    // Copy or move a group with its subtree under dst_group_id, return the id of the copy or NO_ID
+    inline int64_t clone_subtree(int64_t src_group_id, int64_t dst_group_id, bool move) const
+    {
+        return backend.clone_subtree(src_group_id, dst_group_id, move);
+    }
+
+    inline int64_t clone_field(int64_t src_field_id, int64_t dst_group_id, bool move) const
+    {
+        return backend.clone_field(src_field_id, dst_group_id, move);
+    }
+
+    inline storage& get_storage() const noexcept
     {
-        if(auto&& opt_rs = database->execute("SELECT last_insert_rowid() AS id"); opt_rs) //throw exception
-        {
-            if(auto&& it = *opt_rs; !it->empty())
-            {
-                return (*it->begin())["id"].to_integer();
-            }
-        }
-        return NO_ID;
+        return backend;
     }
-    int64_t persist_private(const pods::group::ptr& t, bool return_rows_modified) const;
-    int64_t persist_private(const pods::group_field::ptr& t, bool return_rows_modified) const;
-    int64_t persist_private(const pods::field::ptr& t, bool return_rows_modified) const;
 };
 
 
@@ -0,0 +1,56 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#pragma once
+
+#include "pocket-daos/storage.hpp"
+#include "pocket-daos/memory-table.hpp"
+
+namespace pocket::daos::inline v5
+{
+
+// Backend without disk I/O for ephemeral sessions and as a baseline for the SQLite one.
+// Ids are assigned per table from 1; transactions of services::database do not apply.
+class memory_storage final : public storage
+{
+    memory_table<pods::group> group_table;
+    memory_table<pods::group_field> group_field_table;
+    memory_table<pods::field> field_table;
+public:
+    memory_storage() = default;
+    POCKET_NO_COPY_NO_MOVE(memory_storage)
+    ~memory_storage() override = default;
+
+    inline iface::table_storage<pods::group>& groups() noexcept override
+    {
+        return group_table;
+    }
+
+    inline iface::table_storage<pods::group_field>& group_fields() noexcept override
+    {
+        return group_field_table;
+    }
+
+    inline iface::table_storage<pods::field>& fields() noexcept override
+    {
+        return field_table;
+    }
+};
+
+}
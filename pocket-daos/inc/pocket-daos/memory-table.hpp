@@ -0,0 +1,392 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#pragma once
+
+#include "pocket/globals.hpp"
+#include "pocket/tree.hpp"
+#include "pocket-iface/table-storage.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <shared_mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace pocket::daos::inline v5
+{
+
+// Rows of T kept in a contiguous vector, with hash indexes on id, server_id and group_id.
+// Removing a row moves the last one in its place, so positions are only valid under the lock.
+template<iface::require_pod T>
+class memory_table final : public iface::table_storage<T>
+{
+    std::vector<T> rows;
+    std::unordered_map<int64_t, size_t> by_id; // id -> position in rows
+    std::unordered_multimap<int64_t, int64_t> by_server_id; // server_id -> id, rows never synchronized are not indexed
+    std::unordered_map<int64_t, std::vector<int64_t>> by_group_id; // group_id -> ids
+    int64_t last_id = 0;
+    mutable std::shared_mutex m;
+public:
+    using list = typename iface::table_storage<T>::list;
+    using iface::table_storage<T>::NO_ID;
+
+    memory_table() = default;
+    POCKET_NO_COPY_NO_MOVE(memory_table)
+    ~memory_table() override = default;
+
+    std::optional<typename T::ptr> get(int64_t id) const override
+    {
+        std::shared_lock lock(m);
+        if(auto it = by_id.find(id); it != by_id.end())
+        {
+            return std::make_unique<T>(rows[it->second]);
+        }
+        return std::nullopt;
+    }
+
+    std::optional<typename T::ptr> get_by_server_id(int64_t server_id) const override
+    {
+        std::shared_lock lock(m);
+        if(auto it = by_server_id.find(server_id); it != by_server_id.end())
+        {
+            return std::make_unique<T>(rows[by_id.at(it->second)]);
+        }
+        return std::nullopt;
+    }
+
+    list get_all(int64_t group_id, bool to_synch) const override
+    {
+        std::vector<const T*> selected;
+        std::shared_lock lock(m);
+        if(!to_synch && group_id >= 0)
+        {
+            if(auto it = by_group_id.find(group_id); it != by_group_id.end())
+            {
+                for(auto id : it->second)
+                {
+                    if(auto&& row = rows[by_id.at(id)]; !row.deleted)
+                    {
+                        selected.push_back(&row);
+                    }
+                }
+            }
+        }
+        else
+        {
+            for(auto&& row : rows)
+            {
+                if(to_synch ? !row.synchronized : !row.deleted)
+                {
+                    selected.push_back(&row);
+                }
+            }
+        }
+
+        std::sort(selected.begin(), selected.end(), [](auto a, auto b)
+        {
+            return a->group_id != b->group_id ? a->group_id < b->group_id : a->id < b->id;
+        });
+
+        if constexpr (std::is_same_v<T, pods::group>)
+        {
+            // Same parent before child order as the SQLite backend
+            tree ret;
+            for(auto row : selected)
+            {
+                auto it = std::make_unique<T>(*row);
+                ret + it;
+            }
+            return ret.get();
+        }
+        else
+        {
+            list ret;
+            ret.reserve(selected.size());
+            for(auto row : selected)
+            {
+                ret.push_back(std::make_unique<T>(*row));
+            }
+            return ret;
+        }
+    }
+
+    // Rows are kept as persisted, titles are compared as they are
+    list get_list(int64_t group_id, std::string_view search, size_t limit, size_t offset, bool) const override
+    {
+        auto fold = [](std::string str)
+        {
+            std::transform(str.cbegin(), str.cend(), str.begin(), [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+            return str;
+        };
+        auto&& needle = fold(std::string(search));
+
+        std::vector<const T*> selected;
+        std::shared_lock lock(m);
+        if(auto it = by_group_id.find(group_id); it != by_group_id.end())
+        {
+            for(auto id : it->second)
+            {
+                if(auto&& row = rows[by_id.at(id)]; !row.deleted && (needle.empty() || fold(row.title).find(needle) != std::string::npos))
+                {
+                    selected.push_back(&row);
+                }
+            }
+        }
+
+        std::sort(selected.begin(), selected.end(), [](auto a, auto b)
+        {
+            return a->title != b->title ? a->title < b->title : a->id < b->id;
+        });
+
+        list ret;
+        for(size_t i = offset; i < selected.size() && (limit == 0 || ret.size() < limit); i++)
+        {
+            ret.push_back(std::make_unique<T>(*selected[i]));
+        }
+        return ret;
+    }
+
+    int64_t persist(const typename T::ptr& t, bool return_rows_modified) override
+    {
+        std::unique_lock lock(m);
+        if(t->id > 0)
+        {
+            auto it = by_id.find(t->id);
+            if(it == by_id.end())
+            {
+                return return_rows_modified ? 0 : NO_ID;
+            }
+            unindex(rows[it->second]);
+            rows[it->second] = *t;
+            index(rows[it->second], it->second);
+            return return_rows_modified ? 1 : t->id;
+        }
+
+        rows.push_back(*t);
+        rows.back().id = ++last_id;
+        index(rows.back(), rows.size() - 1);
+        return return_rows_modified ? 1 : last_id;
+    }
+
+    std::vector<int64_t> persist_all(std::span<const typename T::ptr> items) override
+    {
+        std::vector<int64_t> ret;
+        ret.reserve(items.size());
+        std::unique_lock lock(m);
+        for(auto&& t : items)
+        {
+            if(auto it = by_id.find(t->id); t->id > 0 && it != by_id.end())
+            {
+                unindex(rows[it->second]);
+                rows[it->second] = *t;
+                index(rows[it->second], it->second);
+            }
+            else
+            {
+                rows.push_back(*t);
+                if(t->id > 0)
+                {
+                    last_id = std::max(last_id, t->id);
+                }
+                else
+                {
+                    t->id = rows.back().id = ++last_id;
+                }
+                index(rows.back(), rows.size() - 1);
+            }
+            ret.push_back(t->id);
+        }
+        return ret;
+    }
+
+    int64_t del(int64_t id) override
+    {
+        std::unique_lock lock(m);
+        if(auto it = by_id.find(id); it != by_id.end())
+        {
+            mark_deleted(rows[it->second]);
+            return 1;
+        }
+        return 0;
+    }
+
+    int64_t del_all() override
+    {
+        std::unique_lock lock(m);
+        int64_t ret = 0;
+        for(auto&& row : rows)
+        {
+            ret += mark_deleted(row);
+        }
+        return ret;
+    }
+
+    int64_t del_by_group_id(int64_t group_id) override
+    {
+        std::unique_lock lock(m);
+        auto it = by_group_id.find(group_id);
+        if(it == by_group_id.end())
+        {
+            return 0;
+        }
+        int64_t ret = 0;
+        for(auto id : it->second)
+        {
+            ret += mark_deleted(rows[by_id.at(id)]);
+        }
+        return ret;
+    }
+
+    int64_t rm(int64_t id) override
+    {
+        std::unique_lock lock(m);
+        return remove(id) ? 1 : 0;
+    }
+
+    int64_t rm_all() override
+    {
+        std::unique_lock lock(m);
+        auto ret = static_cast<int64_t>(rows.size());
+        rows.clear();
+        by_id.clear();
+        by_server_id.clear();
+        by_group_id.clear();
+        return ret;
+    }
+
+    int64_t rm_by_group_id(int64_t group_id) override
+    {
+        std::unique_lock lock(m);
+        auto it = by_group_id.find(group_id);
+        if(it == by_group_id.end())
+        {
+            return 0;
+        }
+
+        std::vector<int64_t> ids;
+        for(auto id : it->second)
+        {
+            if(rows[by_id.at(id)].deleted)
+            {
+                ids.push_back(id);
+            }
+        }
+        for(auto id : ids)
+        {
+            remove(id);
+        }
+        return static_cast<int64_t>(ids.size());
+    }
+
+    int64_t get_last_id() const override
+    {
+        std::shared_lock lock(m);
+        if(rows.empty())
+        {
+            return NO_ID;
+        }
+        if(by_id.contains(last_id))
+        {
+            return last_id;
+        }
+
+        // Only after the row with the highest id was removed: ids are never reused, so last_id stays
+        int64_t ret = NO_ID;
+        for(auto&& row : rows)
+        {
+            ret = std::max(ret, row.id);
+        }
+        return ret;
+    }
+
+    inline size_t size() const noexcept
+    {
+        std::shared_lock lock(m);
+        return rows.size();
+    }
+
+private:
+    // Return whether the row was not deleted yet
+    static inline bool mark_deleted(T& row) noexcept
+    {
+        auto ret = !row.deleted;
+        row.deleted = true;
+        row.synchronized = false;
+        return ret;
+    }
+
+    void index(const T& row, size_t position)
+    {
+        by_id[row.id] = position;
+        if(row.server_id > 0)
+        {
+            by_server_id.emplace(row.server_id, row.id);
+        }
+        by_group_id[row.group_id].push_back(row.id);
+    }
+
+    void unindex(const T& row) noexcept
+    {
+        if(row.server_id > 0)
+        {
+            auto [first, last] = by_server_id.equal_range(row.server_id);
+            for(auto it = first; it != last; ++it)
+            {
+                if(it->second == row.id)
+                {
+                    by_server_id.erase(it);
+                    break;
+                }
+            }
+        }
+
+        if(auto it = by_group_id.find(row.group_id); it != by_group_id.end())
+        {
+            std::erase(it->second, row.id);
+            if(it->second.empty())
+            {
+                by_group_id.erase(it);
+            }
+        }
+    }
+
+    bool remove(int64_t id) noexcept
+    {
+        auto it = by_id.find(id);
+        if(it == by_id.end())
+        {
+            return false;
+        }
+
+        auto position = it->second;
+        unindex(rows[position]);
+        by_id.erase(it);
+        if(position != rows.size() - 1)
+        {
+            rows[position] = rows.back();
+            by_id[rows[position].id] = position;
+        }
+        rows.pop_back();
+        return true;
+    }
+};
+
+}
@@ -0,0 +1,175 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#pragma once
+
+#include "pocket/globals.hpp"
+#include "pocket-services/database.hpp"
+#include "pocket-daos/table-descriptor.hpp"
+
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pocket::daos::inline v5
+{
+
+// SELECT on the table of T. Values are bound, so the SQL text depends only on the shape of the query
+// and every group_id, user_id, ... shares one prepared statement. The deleted and synchronized flags
+// are written as literals instead: SQLite only uses the partial indexes WHERE deleted = 0 and
+// WHERE synchronized = 0 when the query repeats their predicate, e.g.:
+// select_query<field>().deleted(false).group_id(id).order_by("title").limit(20)
+template<has_table T>
+class select_query final
+{
+    std::vector<std::string_view> projection; // every column of the descriptor when empty
+    std::vector<std::pair<std::string_view, std::string_view>> filters; // column, "?" or a literal
+    services::database::parameters values;
+    std::vector<std::pair<std::string_view, bool>> order; // column, descending
+    std::optional<size_t> limit_rows;
+    size_t offset_rows = 0;
+public:
+    select_query() = default;
+
+    // Only these columns, rows read by dao_read_write leave the others at their default
+    select_query& columns(std::initializer_list<std::string_view> names)
+    {
+        for(auto name : names)
+        {
+            projection.push_back(column_name(name));
+        }
+        return *this;
+    }
+
+    inline select_query& deleted(bool deleted)
+    {
+        return where_literal("deleted", deleted);
+    }
+
+    inline select_query& synchronized(bool synchronized)
+    {
+        return where_literal("synchronized", synchronized);
+    }
+
+    inline select_query& group_id(int64_t group_id)
+    {
+        return where("group_id", group_id);
+    }
+
+    inline select_query& user_id(int64_t user_id)
+    {
+        return where("user_id", user_id);
+    }
+
+    select_query& order_by(std::string_view name, bool descending = false)
+    {
+        order.emplace_back(column_name(name), descending);
+        return *this;
+    }
+
+    // limit 0 for every row
+    select_query& limit(size_t limit, size_t offset = 0) noexcept
+    {
+        limit_rows = limit;
+        offset_rows = offset;
+        return *this;
+    }
+
+    std::string sql() const
+    {
+        std::string ret;
+        if(projection.empty())
+        {
+            ret = table_sql<T>::select.view();
+        }
+        else
+        {
+            ret = "SELECT ";
+            for(size_t i = 0; i < projection.size(); i++)
+            {
+                ret.append(i ? ", " : "").append(projection[i]);
+            }
+            ret.append(" FROM ").append(table_descriptor<T>::name);
+        }
+
+        for(size_t i = 0; i < filters.size(); i++)
+        {
+            ret.append(i ? " AND " : " WHERE ").append(filters[i].first).append(" = ").append(filters[i].second);
+        }
+
+        for(size_t i = 0; i < order.size(); i++)
+        {
+            ret.append(i ? ", " : " ORDER BY ").append(order[i].first).append(order[i].second ? " DESC" : "");
+        }
+
+        if(limit_rows)
+        {
+            ret += " LIMIT ? OFFSET ?";
+        }
+        return ret;
+    }
+
+    // Values in the order of the placeholders of sql()
+    services::database::parameters parameters() const
+    {
+        auto ret = values;
+        if(limit_rows)
+        {
+            ret.emplace_back(*limit_rows == 0 ? int64_t{-1} : static_cast<int64_t>(*limit_rows));
+            ret.emplace_back(static_cast<int64_t>(offset_rows));
+        }
+        return ret;
+    }
+
+private:
+    select_query& where(std::string_view name, int64_t value)
+    {
+        filters.emplace_back(column_name(name), "?");
+        values.emplace_back(value);
+        return *this;
+    }
+
+    select_query& where_literal(std::string_view name, bool value)
+    {
+        filters.emplace_back(column_name(name), value ? "1" : "0");
+        return *this;
+    }
+
+    // Only names of the descriptor reach the SQL text
+    static std::string_view column_name(std::string_view name)
+    {
+        std::string_view ret;
+        for_each_column<T>([&](auto&& column, size_t)
+        {
+            if(column.name == name)
+            {
+                ret = column.name;
+            }
+        });
+        if(ret.empty())
+        {
+            throw std::runtime_error("No column " + std::string(name) + " in " + std::string(table_descriptor<T>::name));
+        }
+        return ret;
+    }
+};
+
+}
@@ -0,0 +1,69 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#pragma once
+
+#include "pocket-daos/storage.hpp"
+#include "pocket-daos/sqlite-table.hpp"
+
+namespace pocket::daos::inline v5
+{
+
+// Backend on the SQLite database of the session
+class sqlite_storage final : public storage
+{
+    sqlite_table<pods::group> group_table;
+    sqlite_table<pods::group_field> group_field_table;
+    sqlite_table<pods::field> field_table;
+    services::database::ptr& database;
+public:
+    explicit sqlite_storage(services::database::ptr& database) noexcept
+    : group_table(database)
+    , group_field_table(database)
+    , field_table(database)
+    , database(database)
+    {}
+    POCKET_NO_COPY_NO_MOVE(sqlite_storage)
+    ~sqlite_storage() override = default;
+
+    inline iface::table_storage<pods::group>& groups() noexcept override
+    {
+        return group_table;
+    }
+
+    inline iface::table_storage<pods::group_field>& group_fields() noexcept override
+    {
+        return group_field_table;
+    }
+
+    inline iface::table_storage<pods::field>& fields() noexcept override
+    {
+        return field_table;
+    }
+
+    // One WITH RECURSIVE query per table
+    subtree get_subtree(int64_t root_group_id) override;
+
+    // INSERT ... SELECT per table in one transaction, new ids mapped in the temp table clone_remap
+    int64_t clone_subtree(int64_t src_group_id, int64_t dst_group_id, bool move) override;
+
+    int64_t clone_field(int64_t src_field_id, int64_t dst_group_id, bool move) override;
+};
+
+}
@@ -0,0 +1,334 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#pragma once
+
+#include "pocket/globals.hpp"
+#include "pocket-services/database.hpp"
+#include "pocket-services/result-set.hpp"
+#include "pocket-iface/table-storage.hpp"
+#include "pocket-daos/dao-read-write.hpp"
+#include "pocket-daos/table-descriptor.hpp"
+#include "pocket-daos/select-query.hpp"
+
+#include <algorithm>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace pocket::daos::inline v5
+{
+
+// Rows of T in the SQLite table of table_descriptor<T>, statements generated by table_sql<T>
+template<iface::require_pod T>
+class sqlite_table final : public iface::table_storage<T>
+{
+    using sql = table_sql<T>;
+    using descriptor = table_descriptor<T>;
+
+    // Rows per upsert statement, within the 32766 host parameters of SQLite
+    constexpr inline static size_t ROWS_PER_UPSERT = std::min<size_t>(500, 32766 / column_count<T>);
+
+    services::database::ptr& database;
+public:
+    using list = typename iface::table_storage<T>::list;
+    using iface::table_storage<T>::NO_ID;
+
+    explicit sqlite_table(services::database::ptr& database) noexcept
+    : database(database)
+    {}
+    POCKET_NO_COPY_NO_MOVE(sqlite_table)
+    ~sqlite_table() override = default;
+
+    std::optional<typename T::ptr> get(int64_t id) const override
+    {
+        static const std::string query(sql::select_by_id.view());
+        return get_where(query, id);
+    }
+
+    std::optional<typename T::ptr> get_by_server_id(int64_t server_id) const override
+    {
+        static const std::string query(sql::select_by_server_id.view());
+        return get_where(query, server_id);
+    }
+
+    list get_all(int64_t group_id, bool to_synch) const override
+    {
+        list ret;
+
+        auto&& query = get_all_query(group_id, to_synch);
+        dao_read_write<T> dao;
+        database->query(query.sql(), query.parameters(), [&](const services::cursor& cursor) //throw exception
+        {
+            if(auto&& it = dao.read(cursor); it.get())
+            {
+                ret.push_back(std::move(it));
+            }
+            return true;
+        });
+
+        return ret;
+    }
+
+    // Filter, sort and page in SQLite: only the rows returned are read, pocket_decrypt() runs on the titles
+    list get_list(int64_t group_id, std::string_view search, size_t limit, size_t offset, bool decrypt) const override
+    {
+        list ret;
+
+        std::string needle(search);
+        std::transform(needle.cbegin(), needle.cend(), needle.begin(), [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+
+        services::database::parameters params = {group_id};
+        std::string query = "SELECT * FROM (SELECT *, " + std::string(decrypt ? "pocket_decrypt(title)" : "title") + " AS plain_title FROM " + std::string(descriptor::name) + " WHERE deleted = 0 AND group_id = ?)";
+        if(!needle.empty())
+        {
+            query += " WHERE instr(pocket_fold(plain_title), ?) > 0";
+            params.push_back(pods::variant::view(needle));
+        }
+        query += " ORDER BY plain_title, id LIMIT ? OFFSET ?";
+        params.emplace_back(limit == 0 ? int64_t{-1} : static_cast<int64_t>(limit));
+        params.emplace_back(static_cast<int64_t>(offset));
+
+        dao_read_write<T> dao;
+        database->query(query, params, [&](const services::cursor& cursor) //throw exception
+        {
+            if(auto&& it = dao.read(cursor); it.get())
+            {
+                ret.push_back(std::move(it));
+            }
+            return true;
+        });
+
+        return ret;
+    }
+
+    int64_t persist(const typename T::ptr& t, bool return_rows_modified) override
+    {
+        static const std::string insert(sql::insert.view());
+        static const std::string update(sql::update.view());
+
+        dao_read_write<T> dao_rw(database->is_ciphertext_raw());
+        auto&& params = dao_rw.write(t);
+
+        auto count = database->update(t->id > 0 ? update : insert, params);
+        if(return_rows_modified && !descriptor::persist_returns_id)
+        {
+            return count;
+        }
+
+        if(count <= 0)
+        {
+            return NO_ID;
+        }
+        return t->id > 0 ? t->id : get_last_inserted_id();
+    }
+
+    // One multi row INSERT ... ON CONFLICT DO UPDATE ... RETURNING id per chunk, all chunks in one transaction
+    std::vector<int64_t> persist_all(std::span<const typename T::ptr> items) override
+    {
+        static const std::string full_chunk_query = upsert_query(ROWS_PER_UPSERT);
+
+        std::vector<int64_t> ret;
+        ret.reserve(items.size());
+
+        dao_read_write<T> dao_rw(database->is_ciphertext_raw());
+        services::database::transaction transaction(*database);
+        for(size_t begin = 0; begin < items.size(); begin += ROWS_PER_UPSERT)
+        {
+            auto&& chunk = items.subspan(begin, std::min(ROWS_PER_UPSERT, items.size() - begin));
+
+            services::database::parameters params;
+            params.reserve(chunk.size() * column_count<T>);
+            std::unordered_set<int64_t> explicit_ids;
+            for(auto&& t : chunk)
+            {
+                for(auto&& param : dao_rw.write(t))
+                {
+                    params.push_back(param);
+                }
+                if(t->id > 0)
+                {
+                    explicit_ids.insert(t->id);
+                }
+                else
+                {
+                    params.emplace_back(int64_t{0});
+                }
+            }
+
+            // RETURNING order is unspecified: ids not given are assigned increasing in VALUES order
+            std::vector<int64_t> assigned;
+            database->query(chunk.size() == ROWS_PER_UPSERT ? full_chunk_query : upsert_query(chunk.size()), params, [&](const services::cursor& cursor) //throw exception
+            {
+                if(auto id = cursor.get_integer(0); !explicit_ids.contains(id))
+                {
+                    assigned.push_back(id);
+                }
+                return true;
+            });
+            std::sort(assigned.begin(), assigned.end());
+
+            auto next = assigned.cbegin();
+            for(auto&& t : chunk)
+            {
+                if(t->id > 0)
+                {
+                    ret.push_back(t->id);
+                }
+                else if(next != assigned.cend())
+                {
+                    ret.push_back(*next++);
+                }
+                else
+                {
+                    throw std::runtime_error("Upsert on " + std::string(descriptor::name) + " returned fewer ids than rows");
+                }
+            }
+        }
+        transaction.commit();
+
+        // Only once committed, a rolled back batch leaves the rows as they were
+        for(size_t i = 0; i < items.size(); i++)
+        {
+            items[i]->id = ret[i];
+        }
+
+        return ret;
+    }
+
+    inline int64_t del(int64_t id) override
+    {
+        static const std::string query = "UPDATE " + std::string(descriptor::name) + " SET deleted = 1, synchronized = 0 WHERE id = ?";
+        return database->update(query, { {id} });
+    }
+
+    inline int64_t del_all() override
+    {
+        static const std::string query = "UPDATE " + std::string(descriptor::name) + " SET deleted = 1, synchronized = 0";
+        return database->update(query);
+    }
+
+    inline int64_t del_by_group_id(int64_t group_id) override
+    {
+        static const std::string query = "UPDATE " + std::string(descriptor::name) + " SET deleted = 1, synchronized = 0 WHERE group_id = ?";
+        return database->update(query, { {group_id} });
+    }
+
+    inline int64_t rm(int64_t id) override
+    {
+        static const std::string query = "DELETE FROM " + std::string(descriptor::name) + " WHERE id = ?";
+        return database->update(query, { {id} });
+    }
+
+    inline int64_t rm_all() override
+    {
+        static const std::string query = "DELETE FROM " + std::string(descriptor::name);
+        return database->update(query);
+    }
+
+    inline int64_t rm_by_group_id(int64_t group_id) override
+    {
+        static const std::string query = "DELETE FROM " + std::string(descriptor::name) + " WHERE deleted = 1 AND group_id = ?";
+        return database->update(query, { {group_id} });
+    }
+
+    int64_t get_last_id() const override
+    {
+        static const std::string query = "SELECT MAX(id) AS id FROM " + std::string(descriptor::name);
+        if(auto&& opt_rs = database->execute(query); opt_rs && !opt_rs.value()->empty()) //throw exception
+        {
+            if(auto id = opt_rs.value()->at(0)["id"].to_integer(); id > 0)
+            {
+                return id;
+            }
+        }
+        return NO_ID;
+    }
+
+    // Query of get_all(), public for the query plan checks
+    static select_query<T> get_all_query(int64_t group_id, bool to_synch)
+    {
+        select_query<T> ret;
+        if(to_synch)
+        {
+            ret.synchronized(false);
+        }
+        else
+        {
+            ret.deleted(false);
+            if(group_id >= 0)
+            {
+                ret.group_id(group_id);
+            }
+        }
+        ret.order_by("group_id").order_by("id");
+        return ret;
+    }
+
+private:
+    std::optional<typename T::ptr> get_where(const std::string& query, int64_t value) const
+    {
+        std::optional<typename T::ptr> ret;
+        dao_read_write<T> dao;
+        database->query(query, {value}, [&](const services::cursor& cursor) //throw exception
+        {
+            if(auto&& it = dao.read(cursor); it.get())
+            {
+                ret = std::move(it);
+                return false;
+            }
+            return true;
+        });
+
+        return ret;
+    }
+
+    static std::string upsert_query(size_t rows)
+    {
+        std::string ret(sql::upsert_head.view());
+        ret.reserve(ret.size() + rows * (sql::upsert_row.view().size() + 2) + sql::upsert_tail.view().size());
+        for(size_t i = 0; i < rows; i++)
+        {
+            if(i)
+            {
+                ret += ", ";
+            }
+            ret += sql::upsert_row.view();
+        }
+        ret += sql::upsert_tail.view();
+        return ret;
+    }
+
+    int64_t get_last_inserted_id() const
+    {
+        if(auto id = database->get_last_insert_rowid(); id > 0)
+        {
+            return id;
+        }
+        return NO_ID;
+    }
+};
+
+template<>
+sqlite_table<pods::group>::list sqlite_table<pods::group>::get_all(int64_t group_id, bool to_synch) const;
+
+
+}
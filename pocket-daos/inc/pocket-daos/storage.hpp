@@ -0,0 +1,80 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#pragma once
+
+#include "pocket/globals.hpp"
+#include "pocket-iface/table-storage.hpp"
+#include "pocket-pods/group.hpp"
+#include "pocket-pods/group-field.hpp"
+#include "pocket-pods/field.hpp"
+#include "pocket-daos/subtree.hpp"
+
+#include <memory>
+#include <type_traits>
+
+namespace pocket::daos::inline v5
+{
+
+// Storage backend behind dao: one table_storage for each pod type
+class storage
+{
+public:
+    using ptr = std::unique_ptr<storage>;
+
+    static constexpr int64_t NO_ID = -1;
+
+    virtual ~storage() = default;
+
+    virtual iface::table_storage<pods::group>& groups() noexcept = 0;
+    virtual iface::table_storage<pods::group_field>& group_fields() noexcept = 0;
+    virtual iface::table_storage<pods::field>& fields() noexcept = 0;
+
+    // Everything below root_group_id, 0 for the whole vault. Walks the groups one get_all() per table
+    // and group, backends that can fetch it in fewer queries override it
+    virtual subtree get_subtree(int64_t root_group_id);
+
+    // Copy src_group_id with everything not deleted below it into dst_group_id, as new rows to synchronize;
+    // with move the source rows are marked as deleted. Return the id of the copy, NO_ID when a group is missing.
+    // Row by row here, backends that can copy in bulk override it
+    virtual int64_t clone_subtree(int64_t src_group_id, int64_t dst_group_id, bool move);
+
+    // Same for a single field, return the id of the copy or NO_ID
+    virtual int64_t clone_field(int64_t src_field_id, int64_t dst_group_id, bool move);
+
+    template<iface::require_pod T>
+    inline iface::table_storage<T>& table() noexcept
+    {
+        if constexpr (std::is_same_v<T, pods::group>)
+        {
+            return groups();
+        }
+        else if constexpr (std::is_same_v<T, pods::group_field>)
+        {
+            return group_fields();
+        }
+        else
+        {
+            static_assert(std::is_same_v<T, pods::field>, "No table for this pod");
+            return fields();
+        }
+    }
+};
+
+}
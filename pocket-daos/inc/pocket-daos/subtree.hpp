@@ -0,0 +1,82 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#pragma once
+
+#include "pocket/globals.hpp"
+#include "pocket-iface/pod.hpp"
+#include "pocket-pods/group.hpp"
+#include "pocket-pods/group-field.hpp"
+#include "pocket-pods/field.hpp"
+
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace pocket::daos::inline v5
+{
+
+// Rows not deleted below a group, by the id of the group they belong to.
+// Each bucket is ordered by id, groups below a deleted group are left out
+struct subtree final
+{
+    template<iface::require_pod T>
+    using by_group = std::unordered_map<int64_t, std::vector<typename T::ptr>>;
+
+    by_group<pods::group> groups;
+    by_group<pods::group_field> group_fields;
+    by_group<pods::field> fields;
+
+    template<iface::require_pod T>
+    inline by_group<T>& rows() noexcept
+    {
+        return rows_of<T>(*this);
+    }
+
+    // Rows of T in group_id, empty when none
+    template<iface::require_pod T>
+    inline const std::vector<typename T::ptr>& children(int64_t group_id) const noexcept
+    {
+        static const std::vector<typename T::ptr> none;
+        auto&& by_group_id = rows_of<T>(*this);
+        auto it = by_group_id.find(group_id);
+        return it != by_group_id.end() ? it->second : none;
+    }
+
+private:
+    template<iface::require_pod T, typename S>
+    static inline auto& rows_of(S& self) noexcept
+    {
+        if constexpr (std::is_same_v<T, pods::group>)
+        {
+            return self.groups;
+        }
+        else if constexpr (std::is_same_v<T, pods::group_field>)
+        {
+            return self.group_fields;
+        }
+        else
+        {
+            static_assert(std::is_same_v<T, pods::field>, "No rows for this pod");
+            return self.fields;
+        }
+    }
+};
+
+}
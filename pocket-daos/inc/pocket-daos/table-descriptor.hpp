@@ -0,0 +1,306 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#pragma once
+
+#include "pocket/globals.hpp"
+#include "pocket-pods/group.hpp"
+#include "pocket-pods/group-field.hpp"
+#include "pocket-pods/field.hpp"
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace pocket::daos::inline v5
+{
+
+enum class column_type : uint8_t
+{
+    INTEGER = 0,
+    TEXT,
+    CIPHERTEXT // TEXT, or BLOB with database::ciphertext_storage::RAW
+};
+
+// A column of a table: name, member of the pod and SQL type. Its ordinal is its position in the descriptor.
+template<typename C, typename M>
+struct column final
+{
+    using member_type = M;
+
+    std::string_view name;
+    M C::* member;
+    column_type type;
+};
+
+// TEXT and CIPHERTEXT columns are std::string members, INTEGER ones any integral
+template<typename C>
+constexpr inline bool is_text_column = std::is_same_v<typename std::remove_cvref_t<C>::member_type, std::string>;
+
+// Table of a pod, specialized for each one: name and columns, id first.
+// Adding a column is adding one line here and to the schema.
+template<typename T>
+struct table_descriptor;
+
+template<>
+struct table_descriptor<pods::group> final
+{
+    constexpr inline static std::string_view name = "groups";
+    constexpr inline static bool persist_returns_id = true; // callers take the result of persist() as the id
+
+    constexpr inline static auto columns = std::tuple{
+        column{"id", &pods::group::id, column_type::INTEGER},
+        column{"server_id", &pods::group::server_id, column_type::INTEGER},
+        column{"user_id", &pods::group::user_id, column_type::INTEGER},
+        column{"group_id", &pods::group::group_id, column_type::INTEGER},
+        column{"server_group_id", &pods::group::server_group_id, column_type::INTEGER},
+        column{"title", &pods::group::title, column_type::CIPHERTEXT},
+        column{"icon", &pods::group::icon, column_type::CIPHERTEXT},
+        column{"_note", &pods::group::note, column_type::CIPHERTEXT},
+        column{"synchronized", &pods::group::synchronized, column_type::INTEGER},
+        column{"deleted", &pods::group::deleted, column_type::INTEGER},
+        column{"timestamp_creation", &pods::group::timestamp_creation, column_type::INTEGER}
+    };
+};
+
+template<>
+struct table_descriptor<pods::group_field> final
+{
+    constexpr inline static std::string_view name = "group_fields";
+    constexpr inline static bool persist_returns_id = false;
+
+    constexpr inline static auto columns = std::tuple{
+        column{"id", &pods::group_field::id, column_type::INTEGER},
+        column{"server_id", &pods::group_field::server_id, column_type::INTEGER},
+        column{"user_id", &pods::group_field::user_id, column_type::INTEGER},
+        column{"group_id", &pods::group_field::group_id, column_type::INTEGER},
+        column{"server_group_id", &pods::group_field::server_group_id, column_type::INTEGER},
+        column{"title", &pods::group_field::title, column_type::CIPHERTEXT},
+        column{"is_hidden", &pods::group_field::is_hidden, column_type::INTEGER},
+        column{"synchronized", &pods::group_field::synchronized, column_type::INTEGER},
+        column{"deleted", &pods::group_field::deleted, column_type::INTEGER},
+        column{"timestamp_creation", &pods::group_field::timestamp_creation, column_type::INTEGER}
+    };
+};
+
+template<>
+struct table_descriptor<pods::field> final
+{
+    constexpr inline static std::string_view name = "fields";
+    constexpr inline static bool persist_returns_id = false;
+
+    constexpr inline static auto columns = std::tuple{
+        column{"id", &pods::field::id, column_type::INTEGER},
+        column{"server_id", &pods::field::server_id, column_type::INTEGER},
+        column{"user_id", &pods::field::user_id, column_type::INTEGER},
+        column{"group_id", &pods::field::group_id, column_type::INTEGER},
+        column{"server_group_id", &pods::field::server_group_id, column_type::INTEGER},
+        column{"group_field_id", &pods::field::group_field_id, column_type::INTEGER},
+        column{"server_group_field_id", &pods::field::server_group_field_id, column_type::INTEGER},
+        column{"title", &pods::field::title, column_type::CIPHERTEXT},
+        column{"value", &pods::field::value, column_type::CIPHERTEXT},
+        column{"is_hidden", &pods::field::is_hidden, column_type::INTEGER},
+        column{"synchronized", &pods::field::synchronized, column_type::INTEGER},
+        column{"deleted", &pods::field::deleted, column_type::INTEGER},
+        column{"timestamp_creation", &pods::field::timestamp_creation, column_type::INTEGER}
+    };
+};
+
+template<typename T>
+concept has_table = requires {
+    table_descriptor<T>::name;
+    table_descriptor<T>::columns;
+};
+
+template<typename T>
+constexpr inline size_t column_count = std::tuple_size_v<std::remove_const_t<decltype(table_descriptor<T>::columns)>>;
+
+// Call f(column, ordinal) on every column of T, in order
+template<has_table T, typename F>
+constexpr void for_each_column(F&& f)
+{
+    [&]<size_t... I>(std::index_sequence<I...>)
+    {
+        (f(std::get<I>(table_descriptor<T>::columns), I), ...);
+    }(std::make_index_sequence<column_count<T>>{});
+}
+
+// NUL terminated SQL text generated at compile time
+template<size_t N>
+struct sql_text final
+{
+    std::array<char, N + 1> text{};
+
+    constexpr std::string_view view() const noexcept
+    {
+        return {text.data(), N};
+    }
+
+    constexpr const char* c_str() const noexcept
+    {
+        return text.data();
+    }
+};
+
+// Appends to out, or only counts the characters when out is nullptr
+struct sql_writer final
+{
+    char* out = nullptr;
+    size_t size = 0;
+
+    constexpr sql_writer& operator<<(std::string_view str) noexcept
+    {
+        for(auto c : str)
+        {
+            if(out)
+            {
+                out[size] = c;
+            }
+            size++;
+        }
+        return *this;
+    }
+};
+
+template<auto generate>
+constexpr auto make_sql() noexcept
+{
+    constexpr size_t size = []
+    {
+        sql_writer counter;
+        generate(counter);
+        return counter.size;
+    }();
+
+    sql_text<size> ret;
+    sql_writer writer{ret.text.data()};
+    generate(writer);
+    return ret;
+}
+
+// Statements on the table of T, columns always in descriptor order so rows decode by ordinal
+template<has_table T>
+struct table_sql final
+{
+    using descriptor = table_descriptor<T>;
+
+    // SELECT <columns> FROM <table>
+    constexpr inline static auto select = make_sql<[](sql_writer& w)
+    {
+        w << "SELECT ";
+        for_each_column<T>([&](auto&& c, size_t i)
+        {
+            w << (i ? ", " : "") << c.name;
+        });
+        w << " FROM " << descriptor::name;
+    }>();
+
+    constexpr inline static auto select_by_id = make_sql<[](sql_writer& w)
+    {
+        w << select.view() << " WHERE id = ?";
+    }>();
+
+    constexpr inline static auto select_by_server_id = make_sql<[](sql_writer& w)
+    {
+        w << select.view() << " WHERE server_id = ?";
+    }>();
+
+    // Every column but id, bound in descriptor order
+    constexpr inline static auto insert = make_sql<[](sql_writer& w)
+    {
+        w << "INSERT INTO " << descriptor::name << " (";
+        for_each_column<T>([&](auto&& c, size_t i)
+        {
+            if(i)
+            {
+                w << (i > 1 ? ", " : "") << c.name;
+            }
+        });
+        w << ") VALUES (";
+        for_each_column<T>([&](auto&&, size_t i)
+        {
+            if(i)
+            {
+                w << (i > 1 ? ", ?" : "?");
+            }
+        });
+        w << ")";
+    }>();
+
+    // Every column but id, bound in descriptor order, then id
+    constexpr inline static auto update = make_sql<[](sql_writer& w)
+    {
+        w << "UPDATE " << descriptor::name << " SET ";
+        for_each_column<T>([&](auto&& c, size_t i)
+        {
+            if(i)
+            {
+                w << (i > 1 ? ", " : "") << c.name << " = ?";
+            }
+        });
+        w << " WHERE id = ?";
+    }>();
+
+    // Multi row upsert, split in head + rows joined by ", " + tail: every column but id, then id.
+    // An id bound as 0 becomes NULL and SQLite assigns it
+    constexpr inline static auto upsert_head = make_sql<[](sql_writer& w)
+    {
+        w << "INSERT INTO " << descriptor::name << " (";
+        for_each_column<T>([&](auto&& c, size_t i)
+        {
+            if(i)
+            {
+                w << c.name << ", ";
+            }
+        });
+        w << "id) VALUES ";
+    }>();
+
+    constexpr inline static auto upsert_row = make_sql<[](sql_writer& w)
+    {
+        w << "(";
+        for_each_column<T>([&](auto&&, size_t i)
+        {
+            if(i)
+            {
+                w << "?, ";
+            }
+        });
+        w << "NULLIF(?, 0))";
+    }>();
+
+    constexpr inline static auto upsert_tail = make_sql<[](sql_writer& w)
+    {
+        w << " ON CONFLICT(id) DO UPDATE SET ";
+        for_each_column<T>([&](auto&& c, size_t i)
+        {
+            if(i)
+            {
+                w << (i > 1 ? ", " : "") << c.name << " = excluded." << c.name;
+            }
+        });
+        w << " RETURNING id";
+    }>();
+};
+
+}
@@ -17,7 +17,7 @@
  *
  ***************************************************************************/
 
-#include "pocket-daos/dao.hpp"
+#include "pocket-daos/sqlite-table.hpp"
 #include "pocket/tree.hpp"
 
 
@@ -28,106 +28,24 @@ using pods::group;
 using namespace std;
 
 template<>
-vector<group::ptr> dao::get_all<group>(int64_t group_id, bool to_synch) const
+sqlite_table<group>::list sqlite_table<group>::get_all(int64_t group_id, bool to_synch) const
 {
     //vector<group::ptr> ret;
     tree ret;
 
 
-    if(auto&& opt_rs = database->execute("SELECT * FROM " + group::get_name() + (to_synch ? " WHERE synchronized = 0" : (group_id < 0 ? " WHERE deleted = 0" : " WHERE deleted = 0 AND group_id = " + std::to_string(group_id))) + " ORDER BY group_id, id"); opt_rs) //throw exception
+    auto&& query = get_all_query(group_id, to_synch);
+    dao_read_write<group> dao;
+    database->query(query.sql(), query.parameters(), [&](const services::cursor& cursor) //throw exception
     {
-        for(auto&& row : **opt_rs)
+        if(auto&& it = dao.read(cursor); it.get())
         {
-            dao_read_write<group> dao;
-            if(auto&& it = dao.read(row); it.get())
-            {
-                //ret.push_back(move(it));
-                ret + it;
-            }
+            ret + it;
         }
-    }
+        return true;
+    });
 
     return ret.get();
 }
 
-int64_t dao::persist_private(const group::ptr& t, bool return_rows_modified) const
-{
-
-    dao_read_write<group> dao_rw;
-
-    auto&& params = dao_rw.write(t);
-    int64_t last_insert_id = daos::dao::NO_ID;
-    if(t->id > 0)
-    {
-        auto count = database->update(R"(
-UPDATE groups
-SET
-    server_id = ?,
-    user_id = ?,
-    group_id = ?,
-    server_group_id = ?,
-    title = ?,
-    icon = ?,
-    _note = ?,
-    synchronized = ?,
-    deleted = ?,
-    timestamp_creation = ?
-WHERE
-    id = ?
-        )", params);
-        
-        if(count > 0)
-        {
-            last_insert_id = t->id;
-        }
-        else
-        {
-            last_insert_id = daos::dao::NO_ID;
-        }
-    }
-    else
-    {
-        auto count = database->update(R"(
-INSERT INTO groups
-(
-    server_id,
-    user_id,
-    group_id,
-    server_group_id,
-    title,
-    icon,
-    _note,
-    synchronized,
-    deleted,
-    timestamp_creation
-) VALUES (
-    ?,
-    ?,
-    ?,
-    ?,
-    ?,
-    ?,
-    ?,
-    ?,
-    ?,
-    ?
-)
-        )", params);
-        
-        if(count > 0)
-        {
-            last_insert_id = get_last_inserted_id();
-        }
-        else
-        {
-            last_insert_id = daos::dao::NO_ID;
-        }
-       
-    }
-
-    return last_insert_id;
 }
-
-
-}
-
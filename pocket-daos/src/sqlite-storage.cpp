@@ -0,0 +1,204 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#include "pocket-daos/sqlite-storage.hpp"
+
+#include <algorithm>
+#include <initializer_list>
+#include <utility>
+
+namespace pocket::daos::inline v5
+{
+
+using namespace std;
+using pods::group;
+using pods::group_field;
+using pods::field;
+
+namespace
+{
+
+// Ids of root_group_id and of the groups not deleted below it; UNION also stops on a group_id cycle
+constexpr char DESCENDANTS[] = "WITH RECURSIVE descendants(id) AS (SELECT ? UNION SELECT groups.id FROM groups JOIN descendants ON groups.group_id = descendants.id WHERE groups.deleted = 0) ";
+
+template<iface::require_pod T>
+void read_subtree(services::database& database, int64_t root_group_id, subtree::by_group<T>& ret)
+{
+    static const string query = DESCENDANTS + string(table_sql<T>::select.view()) + " WHERE deleted = 0 AND group_id IN descendants ORDER BY group_id, id";
+
+    dao_read_write<T> dao;
+    database.query(query, {root_group_id}, [&](const services::cursor& cursor) //throw exception
+    {
+        if(auto&& it = dao.read(cursor); it.get())
+        {
+            auto group_id = it->group_id;
+            ret[group_id].push_back(std::move(it));
+        }
+        return true;
+    });
+}
+
+// INSERT INTO <table> (<columns>) SELECT <src.column, or its override>: every column of T is copied from the row src
+template<has_table T>
+string insert_select(initializer_list<pair<string_view, string_view>> overrides)
+{
+    string columns;
+    string values;
+    for_each_column<T>([&](auto&& column, size_t i)
+    {
+        columns.append(i ? ", " : "").append(column.name);
+        values.append(i ? ", " : "");
+        if(auto it = find_if(overrides.begin(), overrides.end(), [&](auto&& o){ return o.first == column.name; }); it != overrides.end())
+        {
+            values.append(it->second);
+        }
+        else
+        {
+            values.append("src.").append(column.name);
+        }
+    });
+    return "INSERT INTO " + string(table_descriptor<T>::name) + " (" + columns + ") SELECT " + values;
+}
+
+// First id SQLite would not hand out yet on an AUTOINCREMENT table
+string next_id(string_view table)
+{
+    return "MAX(IFNULL((SELECT seq FROM sqlite_sequence WHERE name = '" + string(table) + "'), 0), IFNULL((SELECT MAX(id) FROM " + string(table) + "), 0))";
+}
+
+}
+
+subtree sqlite_storage::get_subtree(int64_t root_group_id)
+{
+    subtree ret;
+    read_subtree<pods::group>(*database, root_group_id, ret.groups);
+    read_subtree<pods::group_field>(*database, root_group_id, ret.group_fields);
+    read_subtree<pods::field>(*database, root_group_id, ret.fields);
+    return ret;
+}
+
+int64_t sqlite_storage::clone_subtree(int64_t src_group_id, int64_t dst_group_id, bool move)
+{
+    // source id -> copy id of the groups and group fields, ids of the copies taken above any in use
+    static const string create_remap = "CREATE TEMP TABLE IF NOT EXISTS clone_remap (kind INTEGER NOT NULL, src INTEGER NOT NULL, dst INTEGER NOT NULL, PRIMARY KEY (kind, src)) WITHOUT ROWID";
+    static const string clear_remap = "DELETE FROM clone_remap";
+    static const string remap_groups = "WITH RECURSIVE descendants(id) AS (SELECT id FROM groups WHERE id = ? AND deleted = 0 UNION SELECT groups.id FROM groups JOIN descendants ON groups.group_id = descendants.id WHERE groups.deleted = 0) "
+                                       "INSERT INTO clone_remap (kind, src, dst) SELECT 0, id, " + next_id("groups") + " + ROW_NUMBER() OVER (ORDER BY id) FROM descendants";
+    static const string remap_group_fields = "INSERT INTO clone_remap (kind, src, dst) SELECT 1, id, " + next_id("group_fields") + " + ROW_NUMBER() OVER (ORDER BY id) FROM group_fields "
+                                             "WHERE deleted = 0 AND group_id IN (SELECT src FROM clone_remap WHERE kind = 0)";
+
+    // ?1 destination group, ?2 its server_id, ?3 timestamp: only the root of the copy keeps the server id of its parent
+    static const string copy_groups = insert_select<group>({
+        {"id", "r.dst"}, {"server_id", "0"}, {"group_id", "IFNULL(p.dst, ?1)"}, {"server_group_id", "CASE WHEN p.dst IS NULL THEN ?2 ELSE 0 END"},
+        {"synchronized", "0"}, {"deleted", "0"}, {"timestamp_creation", "?3"}
+    }) + " FROM clone_remap r JOIN groups src ON src.id = r.src LEFT JOIN clone_remap p ON p.kind = 0 AND p.src = src.group_id WHERE r.kind = 0";
+    static const string copy_group_fields = insert_select<group_field>({
+        {"id", "r.dst"}, {"server_id", "0"}, {"group_id", "p.dst"}, {"server_group_id", "0"},
+        {"synchronized", "0"}, {"deleted", "0"}, {"timestamp_creation", "?1"}
+    }) + " FROM clone_remap r JOIN group_fields src ON src.id = r.src JOIN clone_remap p ON p.kind = 0 AND p.src = src.group_id WHERE r.kind = 1";
+    static const string copy_fields = insert_select<field>({
+        {"id", "NULL"}, {"server_id", "0"}, {"group_id", "p.dst"}, {"server_group_id", "0"},
+        {"group_field_id", "IFNULL(gf.dst, src.group_field_id)"}, {"server_group_field_id", "CASE WHEN gf.dst IS NULL THEN src.server_group_field_id ELSE 0 END"},
+        {"synchronized", "0"}, {"deleted", "0"}, {"timestamp_creation", "?1"}
+    }) + " FROM fields src JOIN clone_remap p ON p.kind = 0 AND p.src = src.group_id LEFT JOIN clone_remap gf ON gf.kind = 1 AND gf.src = src.group_field_id WHERE src.deleted = 0 ORDER BY src.id";
+
+    static const string delete_groups = "UPDATE groups SET deleted = 1, synchronized = 0 WHERE id IN (SELECT src FROM clone_remap WHERE kind = 0)";
+    static const string delete_group_fields = "UPDATE group_fields SET deleted = 1, synchronized = 0 WHERE id IN (SELECT src FROM clone_remap WHERE kind = 1)";
+    static const string delete_fields = "UPDATE fields SET deleted = 1, synchronized = 0 WHERE deleted = 0 AND group_id IN (SELECT src FROM clone_remap WHERE kind = 0)";
+
+    static const string dst_server_id = "SELECT server_id FROM groups WHERE id = ?";
+    static const string copy_id = "SELECT dst FROM clone_remap WHERE kind = 0 AND src = ?";
+
+    services::database::transaction transaction(*database);
+
+    optional<int64_t> server_id;
+    database->query(dst_server_id, {dst_group_id}, [&](const services::cursor& cursor) //throw exception
+    {
+        server_id = cursor.get_integer(0);
+        return false;
+    });
+    if(!server_id)
+    {
+        return NO_ID;
+    }
+
+    database->update(create_remap);
+    database->update(clear_remap);
+    database->update(remap_groups, {src_group_id});
+
+    int64_t ret = NO_ID;
+    database->query(copy_id, {src_group_id}, [&](const services::cursor& cursor) //throw exception
+    {
+        ret = cursor.get_integer(0);
+        return false;
+    });
+    if(ret == NO_ID)
+    {
+        return NO_ID;
+    }
+
+    int64_t now = get_current_time_GMT();
+    database->update(remap_group_fields);
+    database->update(copy_groups, {dst_group_id, *server_id, now});
+    database->update(copy_group_fields, {now});
+    database->update(copy_fields, {now});
+    if(move)
+    {
+        database->update(delete_groups);
+        database->update(delete_group_fields);
+        database->update(delete_fields);
+    }
+    database->update(clear_remap);
+    transaction.commit();
+
+    return ret;
+}
+
+int64_t sqlite_storage::clone_field(int64_t src_field_id, int64_t dst_group_id, bool move)
+{
+    // ?1 source field, ?2 destination group, ?3 timestamp
+    static const string copy_field = insert_select<field>({
+        {"id", "NULL"}, {"server_id", "0"}, {"group_id", "dst.id"}, {"server_group_id", "dst.server_id"},
+        {"synchronized", "0"}, {"timestamp_creation", "?3"}
+    }) + " FROM fields src JOIN groups dst ON dst.id = ?2 WHERE src.id = ?1 AND src.deleted = 0 RETURNING id";
+    static const string delete_field = "UPDATE fields SET deleted = 1, synchronized = 0 WHERE id = ?";
+
+    services::database::transaction transaction(*database);
+
+    int64_t ret = NO_ID;
+    database->query(copy_field, {src_field_id, dst_group_id, static_cast<int64_t>(get_current_time_GMT())}, [&](const services::cursor& cursor) //throw exception
+    {
+        ret = cursor.get_integer(0);
+        return true;
+    });
+    if(ret == NO_ID)
+    {
+        return NO_ID;
+    }
+
+    if(move)
+    {
+        database->update(delete_field, {src_field_id});
+    }
+    transaction.commit();
+
+    return ret;
+}
+
+}
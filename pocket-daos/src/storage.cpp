@@ -0,0 +1,165 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#include "pocket-daos/storage.hpp"
+
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace pocket::daos::inline v5
+{
+
+using namespace std;
+using pods::group;
+using pods::group_field;
+using pods::field;
+
+subtree storage::get_subtree(int64_t root_group_id)
+{
+    subtree ret;
+    unordered_set<int64_t> visited;
+    vector<int64_t> pending{root_group_id};
+    while(!pending.empty())
+    {
+        auto group_id = pending.back();
+        pending.pop_back();
+        if(!visited.insert(group_id).second)
+        {
+            continue;
+        }
+
+        for(auto&& it : groups().get_all(group_id, false))
+        {
+            pending.push_back(it->id);
+            ret.groups[group_id].push_back(std::move(it));
+        }
+        for(auto&& it : group_fields().get_all(group_id, false))
+        {
+            ret.group_fields[group_id].push_back(std::move(it));
+        }
+        for(auto&& it : fields().get_all(group_id, false))
+        {
+            ret.fields[group_id].push_back(std::move(it));
+        }
+    }
+    return ret;
+}
+
+int64_t storage::clone_subtree(int64_t src_group_id, int64_t dst_group_id, bool move)
+{
+    auto&& src = groups().get(src_group_id);
+    auto&& dst = groups().get(dst_group_id);
+    if(!src || !dst || src.value()->deleted)
+    {
+        return NO_ID;
+    }
+
+    // Snapshot first, a copy into its own subtree must not be copied again
+    auto&& tree = get_subtree(src_group_id);
+    auto now = get_current_time_GMT();
+    unordered_map<int64_t, int64_t> group_field_ids; // source -> copy, fields may use those of the groups above
+
+    function<int64_t(const group::ptr&, int64_t, int64_t)> clone = [&](const group::ptr& g, int64_t group_id, int64_t server_group_id)
+    {
+        auto src_id = g->id;
+        g->id = 0;
+        g->server_id = 0;
+        g->group_id = group_id;
+        g->server_group_id = server_group_id;
+        g->synchronized = false;
+        g->timestamp_creation = now;
+        g->id = groups().persist(g, false);
+        if(move)
+        {
+            groups().del(src_id);
+        }
+
+        for(auto&& gf : tree.children<group_field>(src_id))
+        {
+            auto gf_src_id = gf->id;
+            gf->id = 0;
+            gf->server_id = 0;
+            gf->group_id = g->id;
+            gf->server_group_id = 0;
+            gf->synchronized = false;
+            gf->timestamp_creation = now;
+            group_field_ids[gf_src_id] = group_fields().persist(gf, false);
+            if(move)
+            {
+                group_fields().del(gf_src_id);
+            }
+        }
+
+        for(auto&& f : tree.children<field>(src_id))
+        {
+            auto f_src_id = f->id;
+            f->id = 0;
+            f->server_id = 0;
+            f->group_id = g->id;
+            f->server_group_id = 0;
+            if(auto it = group_field_ids.find(f->group_field_id); it != group_field_ids.end())
+            {
+                f->group_field_id = it->second;
+                f->server_group_field_id = 0;
+            }
+            f->synchronized = false;
+            f->timestamp_creation = now;
+            fields().persist(f, false);
+            if(move)
+            {
+                fields().del(f_src_id);
+            }
+        }
+
+        for(auto&& child : tree.children<group>(src_id))
+        {
+            clone(child, g->id, 0);
+        }
+        return g->id;
+    };
+
+    return clone(src.value(), dst.value()->id, dst.value()->server_id);
+}
+
+int64_t storage::clone_field(int64_t src_field_id, int64_t dst_group_id, bool move)
+{
+    auto&& src = fields().get(src_field_id);
+    auto&& dst = groups().get(dst_group_id);
+    if(!src || !dst || src.value()->deleted)
+    {
+        return NO_ID;
+    }
+
+    auto&& f = src.value();
+    f->id = 0;
+    f->server_id = 0;
+    f->group_id = dst.value()->id;
+    f->server_group_id = dst.value()->server_id;
+    f->synchronized = false;
+    f->timestamp_creation = get_current_time_GMT();
+    auto id = fields().persist(f, false);
+    if(move)
+    {
+        fields().del(src_field_id);
+    }
+    return id;
+}
+
+}
@@ -0,0 +1,75 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#pragma once
+
+#include "pocket-iface/pod.hpp"
+
+#include <cinttypes>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace pocket::iface::inline v5
+{
+
+// Storage of the rows of one pod type, implemented by each storage backend
+template<require_pod T>
+struct table_storage
+{
+    using list = std::vector<typename T::ptr>;
+
+    static constexpr int64_t NO_ID = -1;
+
+    virtual ~table_storage() = default;
+
+    virtual std::optional<typename T::ptr> get(int64_t id) const = 0;
+    virtual std::optional<typename T::ptr> get_by_server_id(int64_t server_id) const = 0;
+
+    // Rows not deleted of group_id, of every group when negative; with to_synch the rows not synchronized.
+    // Ordered by group_id, id
+    virtual list get_all(int64_t group_id, bool to_synch) const = 0;
+
+    // Page of the rows not deleted of group_id whose lower case title contains search, ordered by title, id;
+    // limit 0 for every row. With decrypt the titles are decrypted first, where the backend can
+    virtual list get_list(int64_t group_id, std::string_view search, size_t limit, size_t offset, bool decrypt) const = 0;
+
+    // Insert when t->id is 0, update otherwise; return the id, or the rows written with return_rows_modified
+    virtual int64_t persist(const typename T::ptr& t, bool return_rows_modified) = 0;
+
+    // Insert the rows with id 0 and upsert the others, all or none. Ids must not repeat;
+    // every row gets its id written back, the ids are returned in input order too
+    virtual std::vector<int64_t> persist_all(std::span<const typename T::ptr> rows) = 0;
+
+    // Mark as deleted and not synchronized
+    virtual int64_t del(int64_t id) = 0;
+    virtual int64_t del_all() = 0;
+    virtual int64_t del_by_group_id(int64_t group_id) = 0;
+
+    // Remove for good
+    virtual int64_t rm(int64_t id) = 0;
+    virtual int64_t rm_all() = 0;
+    virtual int64_t rm_by_group_id(int64_t group_id) = 0; // only the rows marked as deleted
+
+    // Highest id in use, NO_ID when empty
+    virtual int64_t get_last_id() const = 0;
+};
+
+}
@@ -21,8 +21,11 @@
 
 #include <memory>
 #include <optional>
+#include <cstdint>
 #include <cstring>
+#include <span>
 #include <string>
+#include <string_view>
 
 namespace pocket::pods::inline v5
 {
@@ -40,6 +43,7 @@ public:
         TEXT,
         INT64,
         NULL_T,
+        BLOB,
     };
     using enum variant::type;
 
@@ -48,6 +52,8 @@ private:
     int64_t integer_value = 0;
     double double_value = 0;
     std::string text_value;
+    std::string_view borrowed_value; // set only by view() and blob_view(), text_value stays empty
+    bool borrowed = false;
 public: //keep the ctor not explicit
     variant();
     variant(int32_t value) noexcept;
@@ -56,9 +62,20 @@ public: //keep the ctor not explicit
     variant(uint64_t value) noexcept;
     variant(double value) noexcept;
     variant(const std::string& value) noexcept;
-    variant(const std::string&& value) noexcept;
+    variant(std::string&& value) noexcept;
+    variant(const char* value) noexcept;
     variant(std::nullptr_t) noexcept;
 
+    // TEXT variant that borrows value instead of copying it: the referenced memory
+    // must outlive the variant and all of its copies
+    [[nodiscard]] static variant view(std::string_view value) noexcept;
+
+    // BLOB variant owning bytes
+    [[nodiscard]] static variant blob(std::string bytes) noexcept;
+
+    // BLOB variant borrowing bytes, same lifetime rules as view()
+    [[nodiscard]] static variant blob_view(std::string_view bytes) noexcept;
+
     [[nodiscard]] inline int64_t to_integer() const noexcept
     {
         return integer_value;
@@ -73,13 +90,34 @@ public: //keep the ctor not explicit
     {
         switch(t)
         {
-            default: return text_value;
+            default: return borrowed ? std::string(borrowed_value) : text_value;
             case INT: return std::to_string(integer_value);
             case DOUBLE: return std::to_string(double_value);
             case INT64: return std::to_string(integer_value);
         }
     }
 
+    // Text, or the bytes of a BLOB, without copies; empty for the other types
+    [[nodiscard]] inline std::string_view to_text_view() const noexcept
+    {
+        if(t != TEXT && t != BLOB)
+        {
+            return {};
+        }
+        return borrowed ? borrowed_value : std::string_view(text_value);
+    }
+
+    [[nodiscard]] inline std::span<const uint8_t> to_blob() const noexcept
+    {
+        auto bytes = to_text_view();
+        return {reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size()};
+    }
+
+    [[nodiscard]] inline bool is_borrowed() const noexcept
+    {
+        return borrowed;
+    }
+
     [[nodiscard]] inline enum type get_type() const noexcept
     {
         return t;
@@ -64,10 +64,41 @@ variant::variant(const std::string& value) noexcept
 
 }
 
-variant::variant(const std::string&& value) noexcept
-: variant(value)
+variant::variant(std::string&& value) noexcept
+: t(TEXT)
+, text_value(std::move(value))
+{
+
+}
+
+variant::variant(const char* value) noexcept
+: t(TEXT)
+, text_value(value)
+{
+
+}
+
+variant variant::view(std::string_view value) noexcept
+{
+    variant ret;
+    ret.t = TEXT;
+    ret.borrowed_value = value;
+    ret.borrowed = true;
+    return ret;
+}
+
+variant variant::blob(std::string bytes) noexcept
 {
+    variant ret(std::move(bytes));
+    ret.t = BLOB;
+    return ret;
+}
 
+variant variant::blob_view(std::string_view bytes) noexcept
+{
+    auto ret = view(bytes);
+    ret.t = BLOB;
+    return ret;
 }
 
 variant::variant(nullptr_t) noexcept
@@ -0,0 +1,87 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#pragma once
+
+#include "pocket/globals.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <sqlite3.h>
+
+namespace pocket::services::inline v5
+{
+
+// sqlite3_busy_handler shared by the writer and the read pool connections.
+// Instead of sqlite3_busy_timeout's fixed sleeps it retries with jittered exponential backoff,
+// starting at MIN_BACKOFF, and gives up at the deadline of the call: the one set on the calling
+// thread by a deadline_scope, otherwise timeout after the first busy callback.
+class busy_handler final
+{
+public:
+    constexpr inline static std::chrono::microseconds MIN_BACKOFF{50};
+    constexpr inline static std::chrono::microseconds MAX_BACKOFF{5'000};
+
+    struct metrics final
+    {
+        uint64_t events = 0; // statements that found the database busy
+        uint64_t retries = 0; // busy handler invocations that waited
+        uint64_t timeouts = 0; // statements that gave up with SQLITE_BUSY
+        std::chrono::nanoseconds wait{0}; // total time slept
+    };
+
+    // Deadline for every statement the calling thread runs while in scope, the previous one is restored on exit
+    class deadline_scope final
+    {
+        std::optional<std::chrono::steady_clock::time_point> previous;
+    public:
+        explicit deadline_scope(std::chrono::steady_clock::duration budget) noexcept;
+        ~deadline_scope();
+        POCKET_NO_COPY_NO_MOVE(deadline_scope)
+    };
+
+    explicit busy_handler(std::chrono::milliseconds timeout) noexcept;
+    ~busy_handler() = default;
+    POCKET_NO_COPY_NO_MOVE(busy_handler)
+
+    void install(sqlite3* handle) noexcept;
+
+    inline void set_timeout(std::chrono::milliseconds timeout) noexcept
+    {
+        this->timeout = timeout;
+    }
+
+    metrics get_metrics() const noexcept;
+
+    void reset_metrics() noexcept;
+
+private:
+    std::atomic<std::chrono::milliseconds> timeout;
+
+    std::atomic<uint64_t> events = 0;
+    std::atomic<uint64_t> retries = 0;
+    std::atomic<uint64_t> timeouts = 0;
+    std::atomic<int64_t> wait_ns = 0;
+
+    static int on_busy(void* ctx, int count) noexcept;
+};
+
+}
@@ -0,0 +1,120 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include "pocket/globals.hpp"
+#include "pocket-services/statement-cache.hpp"
+#include "pocket-services/statement-profiler.hpp"
+#include "pocket-services/busy-handler.hpp"
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sqlite3.h>
+
+namespace pocket::services::inline v5
+{
+
+// Pool of read only connections to the same database file.
+// Connections are opened lazily with SQLITE_OPEN_NOMUTEX: a connection is used by one
+// thread at a time through a lease, so SQLite does not need to serialize it.
+class connection_pool final
+{
+public:
+    struct connection final
+    {
+        sqlite3* db = nullptr;
+        statement_cache statements;
+        statement_profiler* profiler = nullptr;
+    };
+
+    class lease final
+    {
+        connection_pool* pool = nullptr;
+        connection* conn = nullptr;
+    public:
+        lease(connection_pool* pool, connection* conn) noexcept
+        : pool(pool)
+        , conn(conn)
+        {}
+        lease(lease&& other) noexcept;
+        lease& operator=(lease&& other) = delete;
+        lease(const lease&) = delete;
+        lease& operator=(const lease&) = delete;
+        ~lease();
+
+        inline connection* operator->() const noexcept
+        {
+            return conn;
+        }
+
+        inline connection& operator*() const noexcept
+        {
+            return *conn;
+        }
+    };
+
+    connection_pool() = default;
+    ~connection_pool();
+    POCKET_NO_COPY_NO_MOVE(connection_pool)
+
+    using setup = std::function<void(sqlite3*)>;
+
+    // busy is installed, pragmas are executed and on_open is called on every new connection, opened through vfs when not nullptr
+    void open(const std::string& file_db_path, size_t max_size, busy_handler* busy, const std::string& pragmas = {}, const char* vfs = nullptr, setup on_open = {}) noexcept;
+
+    // Wait for every leased connection to come back and close them all
+    void close() noexcept;
+
+    // Return an idle connection, open a new one while below max_size, otherwise wait
+    lease acquire();
+
+    inline size_t get_max_size() const noexcept
+    {
+        return max_size;
+    }
+
+    size_t size() const noexcept;
+
+    // Trace every connection with profiler, nullptr to stop; applied to a connection the next time it is leased
+    void set_profiler(statement_profiler* profiler) noexcept;
+
+private:
+    std::string file_db_path;
+    size_t max_size = 0;
+    busy_handler* busy = nullptr;
+    std::string pragmas;
+    std::string vfs;
+    setup on_open;
+    statement_profiler* profiler = nullptr;
+
+    std::vector<std::unique_ptr<connection>> connections;
+    std::vector<connection*> idle;
+    mutable std::mutex m;
+    std::condition_variable cv;
+
+    void release(connection* conn) noexcept;
+};
+
+}
@@ -0,0 +1,57 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#pragma once
+
+#include "pocket/globals.hpp"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace pocket::services::inline v5
+{
+
+// SQLite VFS shim encrypting a database file, its rollback journal and its WAL at rest.
+// Database pages are encrypted with AES-256-XTS in SECTOR_SIZE units tweaked by the sector number,
+// journal and WAL, written at any offset and length, with AES-256-CTR keyed by a nonce and the offset.
+// The nonce, random, is the cleartext prefix of the journal or WAL file: a new one every time SQLite
+// starts the file over, so rewritten offsets never reuse a keystream.
+// Keys are registered per database file, any other file opened through the VFS is passed through.
+class crypto_vfs final
+{
+public:
+    constexpr inline static char NAME[] = "pocket-crypto";
+    constexpr inline static size_t SECTOR_SIZE = 512;
+    constexpr inline static size_t NONCE_SIZE = 8; // bytes before the content of journal and WAL files
+
+    crypto_vfs() = delete;
+
+    // Register the VFS, once and not as the default one
+    static void install();
+
+    // Encrypt file_db_path, its journal and its WAL with keys derived from key
+    static void set_key(const std::string& file_db_path, const std::string_view& key);
+
+    static void remove_key(const std::string& file_db_path) noexcept;
+
+    static bool has_key(const std::string& file_db_path) noexcept;
+};
+
+}
@@ -45,12 +45,14 @@ class aes final
 
     uint8_t key[KEY_SIZE]{0};
     uint8_t iv[AES_BLOCK_SIZE]{0};
+    bool raw = false;
 
 //    EVP_CIPHER_CTX *ctx = nullptr;
 public:
     using ptr = std::unique_ptr<aes>;
 
-    aes(const std::string_view& iv, const std::string_view& key);
+    // raw: encrypt() returns the ciphertext bytes and decrypt() expects them, no base64 on either side
+    aes(const std::string_view& iv, const std::string_view& key, bool raw = false);
     POCKET_NO_COPY_NO_MOVE(aes)
     ~aes();
 
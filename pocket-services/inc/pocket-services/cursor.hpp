@@ -0,0 +1,92 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include "pocket/globals.hpp"
+#include "pocket-pods/variant.hpp"
+
+#include <string_view>
+#include <vector>
+#include <sqlite3.h>
+
+namespace pocket::services::inline v5
+{
+
+// Read only view on the current row of a statement that is being stepped.
+// Values are read straight from sqlite3_column_*, text is valid until the next step.
+class cursor final
+{
+    sqlite3_stmt* stmt = nullptr;
+    std::vector<std::string_view> columns;
+public:
+    explicit cursor(sqlite3_stmt* stmt);
+    POCKET_NO_COPY_NO_MOVE(cursor)
+    ~cursor() = default;
+
+    inline int column_count() const noexcept
+    {
+        return static_cast<int>(columns.size());
+    }
+
+    inline std::string_view column_name(int i) const noexcept
+    {
+        return columns[i];
+    }
+
+    // -1 when the column is not part of the statement
+    int column_index(std::string_view name) const noexcept;
+
+    inline bool is_null(int i) const noexcept
+    {
+        return i < 0 || sqlite3_column_type(stmt, i) == SQLITE_NULL;
+    }
+
+    inline int64_t get_integer(int i) const noexcept
+    {
+        return i < 0 ? 0 : sqlite3_column_int64(stmt, i);
+    }
+
+    inline double get_float(int i) const noexcept
+    {
+        return i < 0 ? 0 : sqlite3_column_double(stmt, i);
+    }
+
+    std::string_view get_text(int i) const noexcept;
+
+    pods::variant get_variant(int i) const;
+
+    inline int64_t get_integer(std::string_view name) const noexcept
+    {
+        return get_integer(column_index(name));
+    }
+
+    inline double get_float(std::string_view name) const noexcept
+    {
+        return get_float(column_index(name));
+    }
+
+    inline std::string_view get_text(std::string_view name) const noexcept
+    {
+        return get_text(column_index(name));
+    }
+};
+
+}
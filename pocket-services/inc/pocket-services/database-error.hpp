@@ -19,27 +19,39 @@
 
 #pragma once
 
-#include "pocket-daos/dao-read-write.hpp"
-#include "pocket-pods/field.hpp"
-
 #include <stdexcept>
+#include <string>
+#include <sqlite3.h>
 
-namespace pocket::daos::inline v5
+namespace pocket::services::inline v5
 {
 
-template<>
-class dao_read_write<pods::field> final : public iface::read_write<services::database::row, services::database::parameters, pods::field>
+// SQLite failure with its extended result code, so callers branch on the code instead of the message
+class database_error final : public std::runtime_error
 {
+    int code;
 public:
-    dao_read_write() = default;
-    ~dao_read_write() override = default;
-    POCKET_NO_COPY_NO_MOVE(dao_read_write)
-
-    pods::field::ptr read(services::database::row& row) override;
-
-    services::database::parameters write(const pods::field::ptr& t) override;
+    database_error(const std::string& msg, int code) noexcept
+    : std::runtime_error(msg)
+    , code(code)
+    {}
+
+    // Extended result code, e.g. SQLITE_BUSY_SNAPSHOT
+    [[nodiscard]] inline int get_code() const noexcept
+    {
+        return code;
+    }
+
+    [[nodiscard]] inline int get_primary_code() const noexcept
+    {
+        return code & 0xff;
+    }
+
+    // Another connection holds the lock: the same call may succeed later
+    [[nodiscard]] inline bool is_busy() const noexcept
+    {
+        return get_primary_code() == SQLITE_BUSY || get_primary_code() == SQLITE_LOCKED;
+    }
 };
 
-
-
-}
\ No newline at end of file
+}
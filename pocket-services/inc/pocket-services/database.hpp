@@ -21,11 +21,28 @@
 
 #include "pocket/globals.hpp"
 #include "pocket-pods/variant.hpp"
+#include "pocket-services/statement-cache.hpp"
+#include "pocket-services/connection-pool.hpp"
+#include "pocket-services/busy-handler.hpp"
+#include "pocket-services/io-monitor.hpp"
+#include "pocket-services/database-error.hpp"
+#include "pocket-services/cursor.hpp"
+#include "pocket-services/row.hpp"
+#include "pocket-services/write-executor.hpp"
+#include "pocket-services/maintenance.hpp"
+#include "pocket-services/migration.hpp"
+#include "pocket-services/small-vector.hpp"
 
+#include <atomic>
 #include <string>
+#include <functional>
 #include <initializer_list>
 #include <map>
 #include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string_view>
+#include <thread>
 #include <vector>
 #include <sqlite3.h>
 
@@ -33,37 +50,346 @@ namespace pocket::services::inline v5
 {
 
 class result_set;
+class aes;
 class database final
 {
-    constexpr inline static uint8_t VERSION = 2;
+    constexpr inline static uint8_t VERSION = 4; // last migrator version
+    constexpr inline static uint8_t CREATION_VERSION = 2; // schema of CREATION_SQL, migrations run from here
     static char const CREATION_SQL[];
-    constexpr inline static uint32_t BUSY_TIMEOUT_MS = 3'000; // Time to wait before retrying when SQLITE_BUSY is encountered
-    constexpr inline static uint8_t BUSY_MAX_RETRIES = 3;
+    constexpr inline static uint32_t BUSY_TIMEOUT_MS = 3'000; // Longest wait for a lock when the call sets no deadline
+    constexpr inline static uint8_t BUSY_MAX_RETRIES = 3; // Retries of the busy errors the busy handler is not called for
+    constexpr inline static size_t STATEMENT_CACHE_CAPACITY = statement_cache::DEFAULT_CAPACITY;
+    constexpr inline static size_t READ_POOL_SIZE = 6; // One read connection for each synchronizer worker
+    constexpr inline static size_t INLINE_PARAMETERS = 16; // Widest statement binds 13 values
 
     std::string file_db_path;
     sqlite3* db = nullptr;
+    statement_cache statements{STATEMENT_CACHE_CAPACITY};
+    busy_handler busy{std::chrono::milliseconds(BUSY_TIMEOUT_MS)};
+    connection_pool reads;
+    write_executor::ptr executor;
+    std::shared_mutex executor_m; // exclusive to start or destroy executor
+    maintenance::ptr housekeeping;
+    statement_profiler profiler;
+    std::atomic<bool> profiling = false;
+    std::shared_ptr<io_monitor> io;
+    mutable std::mutex cipher_m;
+    std::shared_ptr<const aes> cipher;
+    std::string vfs_name;
+
+public:
+    // How writes on the single writer connection are coordinated
+    enum class lock_mode : uint8_t
+    {
+        NONE = 0, // No coordination, rely on the sqlite3 connection mutex and busy timeout only
+        PRAGMA_EXCLUSIVE, // Legacy: toggle PRAGMA locking_mode around every query, disables the read pool
+        WRITER_MUTEX // In-process writer mutex, BEGIN IMMEDIATE transactions for other processes
+    };
+
+#ifdef POCKET_DISABLE_DB_LOCK
+    constexpr inline static lock_mode DEFAULT_LOCK_MODE = lock_mode::NONE;
+#else
+    constexpr inline static lock_mode DEFAULT_LOCK_MODE = lock_mode::WRITER_MUTEX;
+#endif
+
+    // SQLite tuning applied by open(), unset values keep the SQLite defaults
+    struct open_options final
+    {
+        enum class synchronous_mode : uint8_t
+        {
+            OFF = 0,
+            NORMAL = 1, // durable across application crashes, safe in WAL mode
+            FULL = 2,
+            EXTRA = 3
+        };
+
+        lock_mode mode = DEFAULT_LOCK_MODE;
+        uint32_t busy_timeout_ms = BUSY_TIMEOUT_MS;
+        bool wal = true;
+        size_t read_pool_size = READ_POOL_SIZE;
+        std::optional<int64_t> cache_size_kib; // page cache of every connection
+        std::optional<int64_t> mmap_size; // bytes of the file mapped in memory, 0 disables it
+        std::optional<synchronous_mode> synchronous;
+        std::optional<bool> temp_store_memory; // temp tables and indices in memory instead of files
+        std::optional<uint32_t> page_size; // honored only when the database file is created
+        bool incremental_vacuum = true; // auto_vacuum = INCREMENTAL, honored only when the database file is created
+        std::string encryption_key; // not empty: file, journal and WAL encrypted at page level by crypto_vfs, temp files kept in memory
+        bool io_stats = false; // count the file I/O per operation tag through io_vfs, see database::io_stats()
+
+        // Small page cache, no mmap, few readers
+        static open_options mobile_low_memory() noexcept;
+
+        // Large page cache and mmap, relaxed fsync, in memory temp store
+        static open_options desktop_throughput() noexcept;
+
+        // Tuned for the read pool: mmap and cache sized for lookups, more readers
+        static open_options read_mostly() noexcept;
+
+        // Preset by name: "default", "mobile_low_memory", "desktop_throughput" or "read_mostly"
+        static std::optional<open_options> preset(std::string_view name) noexcept;
+
+        // PRAGMA statements for a connection, page_size and synchronous only when for_writer
+        std::string pragmas(bool for_writer) const;
+    };
+
+    // How the encrypted title, value, note and icon columns are stored
+    enum class ciphertext_storage : uint8_t
+    {
+        BASE64 = 0, // base64 TEXT, as sent on the wire
+        RAW = 1 // ciphertext bytes as BLOB, base64 only at the JSON boundary
+    };
+private:
+    open_options options;
+    lock_mode mode = DEFAULT_LOCK_MODE;
+    ciphertext_storage storage = ciphertext_storage::BASE64;
+    std::recursive_mutex writer; // held for every write statement and for the whole write transaction
 
     mutable std::mutex m;
     bool transaction_active = false;
+    std::atomic<uint32_t> transaction_depth = 0; // read by every statement to pick the connection
+    std::atomic<std::thread::id> transaction_owner;
 public:
     using ptr = std::unique_ptr<database>;
 
-    using parameters = std::vector<pods::variant>;
-    using row = std::map<std::string, pods::variant>;
+    // Bound with SQLITE_STATIC: values, and the text borrowed by variant::view(), must outlive the statement execution
+    using parameters = small_vector<pods::variant, INLINE_PARAMETERS>;
+    using row = services::row;
+    using visitor = std::function<bool(const cursor&)>; // return false to stop stepping
+
+    // Cap the lock waits of the statements run by this thread while in scope, e.g. on the UI thread:
+    // database::busy_deadline deadline(std::chrono::milliseconds(50));
+    using busy_deadline = busy_handler::deadline_scope;
+
+    // Attribute the file I/O of the statements run by this thread while in scope, e.g.:
+    // database::io_tag tag("sync.apply");
+    using io_tag = io_monitor::tag_scope;
+
+    // RAII write transaction: BEGIN IMMEDIATE on the outermost level, SAVEPOINT when nested.
+    // Anything not explicitly committed is rolled back on destruction, also when COMMIT itself fails.
+    // With lock_mode WRITER_MUTEX other threads wait for it; in the other modes nothing serializes
+    // threads, a transaction and the ones nested in it must stay on the thread that began it.
+    class transaction final
+    {
+        database& db;
+        std::string savepoint;
+        bool done = false;
+    public:
+        explicit transaction(database& db);
+        ~transaction();
+        POCKET_NO_COPY_NO_MOVE(transaction)
+
+        void commit();
+        void rollback();
+    private:
+        void undo();
+        void end() noexcept;
+        void release() noexcept;
+    };
 
     database();
     ~database();
     POCKET_NO_COPY_NO_MOVE(database)
 
     bool open(const std::string& file_db_path);
+    bool open(const std::string& file_db_path, lock_mode mode);
+    bool open(const std::string& file_db_path, const open_options& options);
     void close();
 
-    std::optional<std::unique_ptr<result_set>> execute(const std::string&& query, const parameters& parameters = {});
+    std::optional<std::unique_ptr<result_set>> execute(const std::string& query, const parameters& parameters = {});
+
+    int64_t update(const std::string& query, const parameters& parameters = {});
+
+    // Step the query lazily and hand every row to visitor without materializing it, return the visited rows
+    int64_t query(const std::string& query, const parameters& parameters, const visitor& visitor);
+
+    // Start the optional single writer thread used by submit(), jobs arrived within window share one transaction
+    void start_executor(std::chrono::microseconds window = write_executor::DEFAULT_WINDOW, size_t max_batch = write_executor::DEFAULT_MAX_BATCH);
+
+    // Run the queued jobs and join the writer thread
+    void stop_executor();
+
+    // Run f(database&) as a write job: on the writer thread when the executor is started, otherwise
+    // right away on the calling thread in its own transaction
+    template<typename F>
+    auto submit(F&& f) -> std::future<std::invoke_result_t<std::decay_t<F>, database&>>
+    {
+        // stop_executor() destroys the executor only once no submit() is using it
+        std::shared_lock lock(executor_m);
+        if(executor)
+        {
+            return executor->submit(std::forward<F>(f));
+        }
+        return write_executor::run(*this, std::forward<F>(f));
+    }
+
+    enum class checkpoint_mode : int
+    {
+        PASSIVE = SQLITE_CHECKPOINT_PASSIVE,
+        FULL = SQLITE_CHECKPOINT_FULL,
+        RESTART = SQLITE_CHECKPOINT_RESTART,
+        TRUNCATE = SQLITE_CHECKPOINT_TRUNCATE
+    };
+
+    // Copy the WAL into the database file; false when readers or writers kept it busy.
+    // log and checkpointed receive the WAL frames and the frames copied.
+    bool checkpoint(checkpoint_mode mode, int* log = nullptr, int* checkpointed = nullptr);
+
+    // Give back at most pages free pages to the file system, return the freed pages
+    int64_t incremental_vacuum(uint32_t pages);
+
+    int64_t get_freelist_count();
+
+    // Bytes of the -wal file, 0 when missing
+    uint64_t get_wal_size() const noexcept;
+
+    inline ciphertext_storage get_ciphertext_storage() const noexcept
+    {
+        return storage;
+    }
+
+    inline bool is_ciphertext_raw() const noexcept
+    {
+        return storage == ciphertext_storage::RAW;
+    }
+
+    // Convert every encrypted column to storage in one transaction and record it in metadata.
+    // Opt-in: base64 stays the default. Requires aes enabled, plaintext columns are not base64.
+    void set_ciphertext_storage(ciphertext_storage storage);
 
-    int64_t update(const std::string&& query, const parameters& parameters = {});
+    // Every connection has pocket_decrypt(column), that decrypts with cipher or returns its argument
+    // when nullptr, and pocket_fold(text), ASCII lower case, to filter and sort encrypted columns in SQL
+    void set_cipher(std::shared_ptr<const aes> cipher) noexcept;
+
+    std::shared_ptr<const aes> get_cipher() const noexcept;
+
+    constexpr inline static int SNAPSHOT_PAGES_PER_STEP = 256;
+
+    // Called after every backup step with the pages still to copy and the total
+    using snapshot_progress = std::function<void(int remaining, int total)>;
+
+    // Copy the database, still encrypted, to file_path with the SQLite backup API.
+    // Writers wait only for the step in progress, between steps they go on and their changes
+    // are carried into the copy. The copy is written next to file_path and renamed when complete.
+    bool snapshot_to(const std::string& file_path, int pages_per_step = SNAPSHOT_PAGES_PER_STEP, const snapshot_progress& progress = {});
+
+    // Replace the content of this database with the snapshot at file_path, writers wait until it ends.
+    // The restored schema is migrated to VERSION.
+    bool restore_from(const std::string& file_path, int pages_per_step = SNAPSHOT_PAGES_PER_STEP, const snapshot_progress& progress = {});
+
+    // Start background checkpoints and incremental vacuum on the writer connection
+    void start_maintenance(const maintenance::options& options = {});
+
+    void stop_maintenance() noexcept;
+
+    inline const maintenance* get_maintenance() const noexcept
+    {
+        return housekeeping.get();
+    }
+
+    // Opt-in sqlite3_trace_v2 profiling of the writer and of the read pool connections
+    void set_profiling(bool enable) noexcept;
+
+    inline bool is_profiling() const noexcept
+    {
+        return profiling;
+    }
+
+    // Invoke callback for every statement slower than threshold, while profiling
+    inline void set_slow_query_callback(std::chrono::nanoseconds threshold, statement_profiler::slow_query_callback callback)
+    {
+        profiler.set_slow_query(threshold, std::move(callback));
+    }
+
+    // Count, latency and rows of every statement run since profiling started or the last reset_stats()
+    inline std::vector<statement_profiler::statement_stats> stats() const
+    {
+        return profiler.stats();
+    }
+
+    inline void reset_stats() noexcept
+    {
+        profiler.reset();
+    }
+
+    // Busy events, retries, timeouts and time spent waiting for locks on every connection
+    inline busy_handler::metrics get_busy_metrics() const noexcept
+    {
+        return busy.get_metrics();
+    }
+
+    inline void reset_busy_metrics() noexcept
+    {
+        busy.reset_metrics();
+    }
+
+    // Reads, writes, syncs and truncates per io_tag on the database file, journal and WAL, empty unless open_options::io_stats
+    inline io_monitor::report io_stats() const
+    {
+        return io ? io->get_report() : io_monitor::report{};
+    }
+
+    inline void reset_io_stats() noexcept
+    {
+        if(io)
+        {
+            io->reset();
+        }
+    }
+
+    inline const write_executor* get_executor() const noexcept
+    {
+        return executor.get();
+    }
+
+    inline int64_t get_last_insert_rowid() const noexcept
+    {
+        return sqlite3_last_insert_rowid(db);
+    }
+
+    inline const statement_cache& get_statement_cache() const noexcept
+    {
+        return statements;
+    }
+
+    inline const connection_pool& get_read_pool() const noexcept
+    {
+        return reads;
+    }
+
+    inline const open_options& get_open_options() const noexcept
+    {
+        return options;
+    }
+
+    inline lock_mode get_lock_mode() const noexcept
+    {
+        return mode;
+    }
+
+    inline bool in_transaction() const noexcept
+    {
+        return transaction_depth > 0;
+    }
+
+    // The calling thread began the current transaction
+    inline bool owns_transaction() const noexcept
+    {
+        return in_transaction() && transaction_owner == std::this_thread::get_id();
+    }
 
 private:
     friend result_set;
+    friend transaction;
+
+    // Scoped write coordination for the writer connection, according to mode
+    class write_guard final
+    {
+        database& db;
+    public:
+        explicit write_guard(database& db);
+        ~write_guard();
+        POCKET_NO_COPY_NO_MOVE(write_guard)
+    };
 
     bool is_created(uint8_t& db_version) noexcept;
     bool create(const char creation_sql[]);
@@ -72,6 +398,20 @@ private:
     void lock();
     void unlock();
     void set_wal_mode() noexcept;
+    void load_ciphertext_storage() noexcept;
+    void open_read_pool() noexcept;
+
+    void create_functions(sqlite3* handle) noexcept;
+
+    // VFS the database files are opened through, nullptr for the default one
+    inline const char* get_vfs() const noexcept
+    {
+        return vfs_name.empty() ? nullptr : vfs_name.c_str();
+    }
+    void exec(const std::string& query);
+
+    static void bind(sqlite3_stmt* stmt, const parameters& parameters) noexcept;
+    int64_t step(sqlite3* handle, statement_cache& cache, const std::string& query, const parameters& parameters, const visitor& visitor);
 
     // Helper function to handle SQLITE_BUSY with retry
     template<typename Func>
@@ -0,0 +1,93 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#pragma once
+
+#include "pocket/globals.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace pocket::services::inline v5
+{
+
+// Calls, bytes and latency histograms of the file I/O of a database, per operation tag.
+// The tag is the one set on the calling thread by a tag_scope, UNTAGGED otherwise.
+class io_monitor final
+{
+public:
+    enum class call : uint8_t
+    {
+        READ = 0,
+        WRITE,
+        SYNC,
+        TRUNCATE
+    };
+    constexpr inline static size_t CALLS = 4;
+
+    // Bucket i counts the calls that took less than 2^i microseconds, the last one the slower ones
+    constexpr inline static size_t BUCKETS = 20;
+
+    constexpr inline static char UNTAGGED[] = "untagged";
+
+    struct counters final
+    {
+        uint64_t calls = 0;
+        uint64_t bytes = 0; // read or written, the new size for TRUNCATE
+        std::chrono::nanoseconds time{0};
+        std::array<uint64_t, BUCKETS> histogram{};
+    };
+
+    using report = std::map<std::string, std::array<counters, CALLS>, std::less<>>;
+
+    // Tag of the I/O the calling thread does while in scope, the previous one is restored on exit.
+    // tag must outlive the scope, e.g. a literal as "sync.apply"
+    class tag_scope final
+    {
+        std::string_view previous;
+    public:
+        explicit tag_scope(std::string_view tag) noexcept;
+        ~tag_scope();
+        POCKET_NO_COPY_NO_MOVE(tag_scope)
+    };
+
+    io_monitor() = default;
+    POCKET_NO_COPY_NO_MOVE(io_monitor)
+
+    static std::string_view get_tag() noexcept;
+
+    static const char* to_string(call c) noexcept;
+
+    void record(call c, uint64_t bytes, std::chrono::nanoseconds elapsed) noexcept;
+
+    report get_report() const;
+
+    void reset() noexcept;
+
+private:
+    mutable std::mutex m;
+    report counters_by_tag;
+};
+
+}
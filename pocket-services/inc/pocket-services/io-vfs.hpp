@@ -0,0 +1,50 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#pragma once
+
+#include "pocket/globals.hpp"
+#include "pocket-services/io-monitor.hpp"
+
+#include <memory>
+#include <string>
+
+namespace pocket::services::inline v5
+{
+
+// Pass-through SQLite VFS timing xRead, xWrite, xSync and xTruncate on the files of the databases
+// attached to an io_monitor: the database file, its journal and its WAL.
+// Pages read through mmap do not call xRead, set open_options::mmap_size to 0 to count them.
+class io_vfs final
+{
+public:
+    constexpr inline static char NAME[] = "pocket-io";
+
+    io_vfs() = delete;
+
+    // Register a VFS over parent, nullptr for the default one, and return its name
+    static const char* install(const char* parent = nullptr);
+
+    // Count the I/O on file_db_path in monitor, files already open are not counted
+    static void attach(const std::string& file_db_path, std::shared_ptr<io_monitor> monitor);
+
+    static void detach(const std::string& file_db_path) noexcept;
+};
+
+}
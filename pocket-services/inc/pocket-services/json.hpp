@@ -22,6 +22,7 @@
 #include "pocket-iface/synchronizable.hpp"
 #include "pocket-pods/device.hpp"
 #include "pocket-pods/helpers.hpp"
+#include "pocket-services/database.hpp"
 #include "BS_thread_pool.hpp"
 
 #include <nlohmann/json.hpp>
@@ -31,9 +32,11 @@
 namespace pocket::services::inline v5
 {
 
-void json_parse_net_helper(BS::thread_pool<>& pool, std::string_view json_response, pods::net_helper& net_helper);
+// raw_ciphertext: the encrypted fields are raw bytes in the pods and base64 on the wire,
+// see database::ciphertext_storage
+void json_parse_net_helper(BS::thread_pool<>& pool, std::string_view json_response, pods::net_helper& net_helper, bool raw_ciphertext = false);
 
-std::string net_helper_serialize_json(const pods::net_helper& net_helper);
+std::string net_helper_serialize_json(const pods::net_helper& net_helper, bool raw_ciphertext = false);
 
 pods::device json_to_device(const std::string_view& str_json);
 
@@ -41,18 +44,21 @@ std::string json_to_aes_cbc_iv(const std::string_view& str_json);
 
 std::string json_to_cors_header_token(const std::string_view& str_json);
 
+// Optional "database" field: a preset name or an object with "preset" and single overrides
+database::open_options json_to_open_options(const std::string_view& str_json);
+
 pods::device json_to_device(const nlohmann::json& json);
 
 pods::user json_to_user(const nlohmann::json& json);
 
-nlohmann::json serialize_json(const pods::group::ptr& group, bool no_id = false);
-pods::group json_to_group(const nlohmann::json& json, bool no_id = false);
+nlohmann::json serialize_json(const pods::group::ptr& group, bool no_id = false, bool raw_ciphertext = false);
+pods::group json_to_group(const nlohmann::json& json, bool no_id = false, bool raw_ciphertext = false);
 
-nlohmann::json serialize_json(const pods::group_field::ptr& group, bool no_id = false);
-pods::group_field json_to_group_field(const nlohmann::json& json, bool no_id = false);
+nlohmann::json serialize_json(const pods::group_field::ptr& group, bool no_id = false, bool raw_ciphertext = false);
+pods::group_field json_to_group_field(const nlohmann::json& json, bool no_id = false, bool raw_ciphertext = false);
 
-nlohmann::json serialize_json(const pods::field::ptr& group, bool no_id = false);
-pods::field json_to_field(const nlohmann::json& json, bool no_id = false);
+nlohmann::json serialize_json(const pods::field::ptr& group, bool no_id = false, bool raw_ciphertext = false);
+pods::field json_to_field(const nlohmann::json& json, bool no_id = false, bool raw_ciphertext = false);
 
 uint64_t json_to_timestamp(std::string_view json_response);
 
@@ -0,0 +1,101 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include "pocket/globals.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <sqlite3.h>
+
+namespace pocket::services::inline v5
+{
+
+class database;
+
+// Background WAL and free page housekeeping for the writer connection.
+// The WAL hook replaces SQLite's autocheckpoint: a PASSIVE checkpoint runs on this thread once the
+// WAL passes checkpoint_pages, a TRUNCATE one when the database is idle or the WAL passes truncate_pages.
+// While idle, free pages left by deleted rows are given back with PRAGMA incremental_vacuum in bounded slices.
+class maintenance final
+{
+public:
+    using ptr = std::unique_ptr<maintenance>;
+
+    struct options final
+    {
+        std::chrono::milliseconds tick{1'000}; // how often idle work is evaluated
+        std::chrono::milliseconds idle_after{2'000}; // no commits for this long means idle
+        uint32_t checkpoint_pages = 1'000;
+        uint32_t truncate_pages = 10'000;
+        uint32_t vacuum_threshold_pages = 256; // free pages before vacuuming
+        uint32_t vacuum_slice_pages = 128; // pages freed per tick, bounds the write lock time
+    };
+
+    struct metrics final
+    {
+        uint64_t wal_size = 0; // bytes of the -wal file
+        int64_t wal_pages = 0; // frames not yet checkpointed at the last commit
+        int64_t freelist_pages = 0;
+        uint64_t passive_checkpoints = 0;
+        uint64_t truncate_checkpoints = 0;
+        uint64_t vacuumed_pages = 0;
+    };
+
+    maintenance(database& db, sqlite3* handle, const options& options);
+    ~maintenance();
+    POCKET_NO_COPY_NO_MOVE(maintenance)
+
+    // Unregister the WAL hook, restore SQLite autocheckpoint and join the thread
+    void stop() noexcept;
+
+    metrics get_metrics() const;
+
+private:
+    database& db;
+    sqlite3* handle;
+    options opts;
+
+    std::atomic<int64_t> wal_pages = 0;
+    std::atomic<int64_t> last_commit; // steady_clock ticks
+    std::atomic<uint64_t> passive_checkpoints = 0;
+    std::atomic<uint64_t> truncate_checkpoints = 0;
+    std::atomic<uint64_t> vacuumed_pages = 0;
+
+    std::mutex m;
+    std::condition_variable cv;
+    bool stopping = false;
+    bool checkpoint_requested = false;
+    std::thread worker;
+    std::atomic<std::thread::id> worker_id;
+    bool vacuum_supported = true;
+
+    static int on_wal_commit(void* ctx, sqlite3* handle, const char* name, int pages) noexcept;
+    void loop() noexcept;
+    void run() noexcept;
+};
+
+}
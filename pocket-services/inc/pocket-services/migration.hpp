@@ -0,0 +1,61 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include "pocket/globals.hpp"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace pocket::services::inline v5
+{
+
+class database;
+
+// One schema step, brings metadata.version from version - 1 to version
+struct migration final
+{
+    uint32_t version = 0;
+    std::string_view description;
+    std::string_view sql; // statements separated by ';'
+};
+
+// Applies the pending migrations in version order, each one in its own transaction together
+// with the update of metadata.version, so a failing step leaves the previous version intact.
+class migrator final
+{
+    database& db;
+public:
+    explicit migrator(database& db) noexcept;
+    POCKET_NO_COPY_NO_MOVE(migrator)
+    ~migrator() = default;
+
+    // Built-in migrations of the pocket schema
+    static const std::vector<migration>& get_migrations() noexcept;
+
+    uint32_t get_version();
+
+    // Return the version reached, throw when a migration fails
+    uint32_t migrate(const std::vector<migration>& migrations = get_migrations());
+};
+
+}
@@ -0,0 +1,94 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include "pocket/globals.hpp"
+
+#include <atomic>
+
+namespace pocket::services::inline v5
+{
+
+// Intrusive lock-free multi producer single consumer queue (Vyukov).
+// push() is wait-free and may be called from any thread, pop() only from the consumer thread.
+class mpsc_queue final
+{
+public:
+    struct node
+    {
+        std::atomic<node*> next = nullptr;
+    };
+
+    mpsc_queue() noexcept = default;
+    ~mpsc_queue() = default;
+    POCKET_NO_COPY_NO_MOVE(mpsc_queue)
+
+    inline void push(node* n) noexcept
+    {
+        n->next.store(nullptr, std::memory_order_relaxed);
+        auto prev = head.exchange(n, std::memory_order_acq_rel);
+        prev->next.store(n, std::memory_order_release);
+    }
+
+    // nullptr when empty or when a producer is halfway through push(), retry in that case
+    inline node* pop() noexcept
+    {
+        auto t = tail;
+        auto next = t->next.load(std::memory_order_acquire);
+        if(t == &stub)
+        {
+            if(next == nullptr)
+            {
+                return nullptr;
+            }
+            tail = next;
+            t = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+
+        if(next)
+        {
+            tail = next;
+            return t;
+        }
+
+        if(t != head.load(std::memory_order_acquire))
+        {
+            return nullptr;
+        }
+
+        push(&stub);
+        next = t->next.load(std::memory_order_acquire);
+        if(next)
+        {
+            tail = next;
+            return t;
+        }
+        return nullptr;
+    }
+
+private:
+    node stub;
+    std::atomic<node*> head = &stub;
+    node* tail = &stub; //consumer only
+};
+
+}
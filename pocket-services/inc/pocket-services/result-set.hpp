@@ -28,17 +28,27 @@
 namespace pocket::services::inline v5
 {
 
-class result_set final : public std::vector<std::map<std::string, pods::variant>>
+class result_set final : public std::vector<database::row>
 {
     class database& database;
+    sqlite3* handle = nullptr;
+    statement_cache& statements;
     sqlite3_stmt* stmt = nullptr;
     int statement_stat = SQLITE_OK;
+    int extended_stat = SQLITE_OK;
     int64_t total_changes = 0;
 public:
 
     using ptr = std::unique_ptr<result_set>;
 
-    result_set(class database& database, const std::string& query, const database::parameters& parameters = {});
+    inline result_set(class database& database, const std::string& query, const database::parameters& parameters = {})
+            : result_set(database, database.db, database.statements, query, parameters)
+    {}
+
+    // Run the query on a read connection of the pool instead of the database writer connection
+    inline result_set(class database& database, connection_pool::connection& connection, const std::string& query, const database::parameters& parameters = {})
+            : result_set(database, connection.db, connection.statements, query, parameters)
+    {}
 
     inline result_set(class database& database, const std::string&& query, const database::parameters& parameters = {})
             : result_set(database, query, parameters)
@@ -61,12 +71,21 @@ public:
         return statement_stat;
     }
 
+    // Extended result code of statement_stat, e.g. SQLITE_BUSY_SNAPSHOT
+    inline int get_extended_stat() const noexcept
+    {
+        return extended_stat;
+    }
+
     inline int64_t get_total_changes() const noexcept
     {
         return total_changes;
     }
 private:
     using vector::push_back;
+    using vector::emplace_back;
+
+    result_set(class database& database, sqlite3* handle, statement_cache& statements, const std::string& query, const database::parameters& parameters);
 };
 
 
@@ -0,0 +1,158 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include "pocket/globals.hpp"
+#include "pocket-pods/variant.hpp"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <sqlite3.h>
+
+namespace pocket::services::inline v5
+{
+
+// Column names of a statement, resolved once and shared by every row it produces
+class column_schema final
+{
+    std::vector<std::string> names; //ordinal -> name
+    std::unordered_map<std::string_view, int> idx; //name -> ordinal, keys point into names
+public:
+    using ptr = std::shared_ptr<const column_schema>;
+
+    explicit column_schema(sqlite3_stmt* stmt);
+    POCKET_NO_COPY_NO_MOVE(column_schema)
+    ~column_schema() = default;
+
+    // -1 when the column is not part of the statement, on duplicated names the last one wins
+    inline int index_of(std::string_view name) const noexcept
+    {
+        if(auto it = idx.find(name); it != idx.end())
+        {
+            return it->second;
+        }
+        return -1;
+    }
+
+    inline const std::string& name(size_t ordinal) const noexcept
+    {
+        return names[ordinal];
+    }
+
+    inline size_t size() const noexcept
+    {
+        return names.size();
+    }
+};
+
+// Flat row: one contiguous vector of values addressed by ordinal, names are resolved through the shared schema
+class row final
+{
+    column_schema::ptr schema;
+    std::vector<pods::variant> values;
+public:
+    using entry = std::pair<const std::string&, const pods::variant&>;
+
+    class iterator final
+    {
+        const row* r = nullptr;
+        size_t i = 0;
+
+        struct arrow final
+        {
+            entry e;
+            inline const entry* operator->() const noexcept
+            {
+                return &e;
+            }
+        };
+    public:
+        iterator(const row* r, size_t i) noexcept
+        : r(r)
+        , i(i)
+        {}
+
+        inline entry operator*() const noexcept
+        {
+            return {r->schema->name(i), r->values[i]};
+        }
+
+        inline arrow operator->() const noexcept
+        {
+            return {**this};
+        }
+
+        inline iterator& operator++() noexcept
+        {
+            i++;
+            return *this;
+        }
+
+        inline bool operator==(const iterator& other) const noexcept
+        {
+            return r == other.r && i == other.i;
+        }
+    };
+
+    row() = default;
+    row(column_schema::ptr schema, std::vector<pods::variant>&& values) noexcept;
+
+    // Null variant when name is not a column, nothing is inserted
+    const pods::variant& operator[](std::string_view name) const noexcept;
+
+    inline const pods::variant& at(size_t ordinal) const
+    {
+        return values.at(ordinal);
+    }
+
+    iterator find(std::string_view name) const noexcept;
+
+    inline iterator begin() const noexcept
+    {
+        return {this, 0};
+    }
+
+    inline iterator end() const noexcept
+    {
+        return {this, values.size()};
+    }
+
+    inline bool empty() const noexcept
+    {
+        return values.empty();
+    }
+
+    inline size_t size() const noexcept
+    {
+        return values.size();
+    }
+
+    inline const column_schema::ptr& get_schema() const noexcept
+    {
+        return schema;
+    }
+};
+
+}
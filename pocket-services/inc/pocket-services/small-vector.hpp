@@ -0,0 +1,251 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace pocket::services::inline v5
+{
+
+// Vector that keeps up to N elements inline and moves to the heap only past that.
+// Used for statement parameters: most queries bind a handful of values, so building them allocates nothing.
+template<typename T, size_t N>
+class small_vector final
+{
+    alignas(T) std::byte buffer[N * sizeof(T)];
+    T* items = reinterpret_cast<T*>(buffer);
+    size_t count = 0;
+    size_t capacity = N;
+
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    small_vector() noexcept = default;
+
+    small_vector(std::initializer_list<T> init)
+    {
+        reserve(init.size());
+        for(auto&& item : init)
+        {
+            push_back(item);
+        }
+    }
+
+    small_vector(const small_vector& other)
+    {
+        reserve(other.count);
+        for(auto&& item : other)
+        {
+            push_back(item);
+        }
+    }
+
+    small_vector(small_vector&& other) noexcept
+    {
+        steal(other);
+    }
+
+    ~small_vector()
+    {
+        clear();
+        release();
+    }
+
+    small_vector& operator=(const small_vector& other)
+    {
+        if(this != &other)
+        {
+            clear();
+            reserve(other.count);
+            for(auto&& item : other)
+            {
+                push_back(item);
+            }
+        }
+        return *this;
+    }
+
+    small_vector& operator=(small_vector&& other) noexcept
+    {
+        if(this != &other)
+        {
+            clear();
+            release();
+            steal(other);
+        }
+        return *this;
+    }
+
+    template<typename... Args>
+    inline T& emplace_back(Args&&... args)
+    {
+        if(count == capacity)
+        {
+            reserve(capacity * 2);
+        }
+        auto ret = std::construct_at(items + count, std::forward<Args>(args)...);
+        count++;
+        return *ret;
+    }
+
+    inline void push_back(const T& item)
+    {
+        emplace_back(item);
+    }
+
+    inline void push_back(T&& item)
+    {
+        emplace_back(std::move(item));
+    }
+
+    void reserve(size_t new_capacity)
+    {
+        if(new_capacity <= capacity)
+        {
+            return;
+        }
+        auto grown = static_cast<T*>(::operator new(new_capacity * sizeof(T), std::align_val_t{alignof(T)}));
+        std::uninitialized_move(items, items + count, grown);
+        std::destroy(items, items + count);
+        release();
+        items = grown;
+        capacity = new_capacity;
+    }
+
+    inline void clear() noexcept
+    {
+        std::destroy(items, items + count);
+        count = 0;
+    }
+
+    [[nodiscard]] inline size_t size() const noexcept
+    {
+        return count;
+    }
+
+    [[nodiscard]] inline bool empty() const noexcept
+    {
+        return count == 0;
+    }
+
+    // true while the elements live in the inline buffer
+    [[nodiscard]] inline bool is_inline() const noexcept
+    {
+        return items == reinterpret_cast<const T*>(buffer);
+    }
+
+    inline T& operator[](size_t i) noexcept
+    {
+        return items[i];
+    }
+
+    inline const T& operator[](size_t i) const noexcept
+    {
+        return items[i];
+    }
+
+    inline const T& at(size_t i) const
+    {
+        if(i >= count)
+        {
+            throw std::out_of_range("small_vector index out of range");
+        }
+        return items[i];
+    }
+
+    inline T& back() noexcept
+    {
+        return items[count - 1];
+    }
+
+    inline T* data() noexcept
+    {
+        return items;
+    }
+
+    inline const T* data() const noexcept
+    {
+        return items;
+    }
+
+    inline iterator begin() noexcept
+    {
+        return items;
+    }
+
+    inline iterator end() noexcept
+    {
+        return items + count;
+    }
+
+    inline const_iterator begin() const noexcept
+    {
+        return items;
+    }
+
+    inline const_iterator end() const noexcept
+    {
+        return items + count;
+    }
+
+private:
+    inline void release() noexcept
+    {
+        if(!is_inline())
+        {
+            ::operator delete(items, std::align_val_t{alignof(T)});
+            items = reinterpret_cast<T*>(buffer);
+            capacity = N;
+        }
+    }
+
+    // Take the heap block of other, or move its inline elements one by one
+    inline void steal(small_vector& other) noexcept
+    {
+        if(other.is_inline())
+        {
+            std::uninitialized_move(other.items, other.items + other.count, items);
+            count = other.count;
+            other.clear();
+        }
+        else
+        {
+            items = other.items;
+            count = other.count;
+            capacity = other.capacity;
+            other.items = reinterpret_cast<T*>(other.buffer);
+            other.count = 0;
+            other.capacity = N;
+        }
+    }
+};
+
+}
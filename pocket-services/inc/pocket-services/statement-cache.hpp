@@ -0,0 +1,80 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include "pocket/globals.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <sqlite3.h>
+
+namespace pocket::services::inline v5
+{
+
+// Bounded LRU cache of prepared statements keyed by SQL text.
+// A statement is checked out by acquire() and is not visible to other threads until
+// release() resets it and puts it back, so concurrent callers never share a sqlite3_stmt.
+class statement_cache final
+{
+    using entry = std::pair<std::string, sqlite3_stmt*>;
+
+    size_t capacity;
+    std::list<entry> lru; //front is the most recently used
+    std::unordered_map<std::string_view, std::list<entry>::iterator> idx; //keys point into lru
+
+    mutable std::mutex m;
+    std::atomic<uint64_t> hits = 0;
+    std::atomic<uint64_t> misses = 0;
+public:
+    static inline constexpr size_t DEFAULT_CAPACITY = 64;
+
+    explicit statement_cache(size_t capacity = DEFAULT_CAPACITY) noexcept;
+    ~statement_cache();
+    POCKET_NO_COPY_NO_MOVE(statement_cache)
+
+    // Return a ready to bind statement for query, preparing it on miss; rc receives the sqlite3_prepare_v3 result
+    sqlite3_stmt* acquire(sqlite3* db, const std::string& query, int& rc);
+
+    // Reset the statement and give it back to the cache, the least recently used one is finalized when full
+    void release(const std::string& query, sqlite3_stmt* stmt) noexcept;
+
+    // Finalize every cached statement, to call before sqlite3_close
+    void clear() noexcept;
+
+    inline uint64_t get_hits() const noexcept
+    {
+        return hits;
+    }
+
+    inline uint64_t get_misses() const noexcept
+    {
+        return misses;
+    }
+
+    size_t size() const noexcept;
+};
+
+}
@@ -0,0 +1,101 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include "pocket/globals.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <sqlite3.h>
+
+namespace pocket::services::inline v5
+{
+
+// Per statement timings collected with sqlite3_trace_v2(SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE | SQLITE_TRACE_ROW).
+// Statements are grouped by their SQL with literals replaced by '?', so the same query issued
+// with inlined ids counts as one entry: a high count with a low average is an N+1 pattern.
+class statement_profiler final
+{
+public:
+    struct statement_stats final
+    {
+        std::string statement; // normalized SQL
+        uint64_t count = 0;
+        uint64_t rows = 0;
+        std::chrono::nanoseconds total{0};
+        std::chrono::nanoseconds avg{0};
+        std::chrono::nanoseconds p99{0};
+        std::chrono::nanoseconds max{0};
+    };
+
+    // Called on the thread that ran the statement, keep it short
+    using slow_query_callback = std::function<void(const std::string& sql, std::chrono::nanoseconds elapsed)>;
+
+    static inline constexpr size_t SAMPLES = 1'024; // latencies kept per statement for p99
+    static inline constexpr size_t MAX_RAW_STATEMENTS = 4'096;
+
+    statement_profiler() = default;
+    ~statement_profiler() = default;
+    POCKET_NO_COPY_NO_MOVE(statement_profiler)
+
+    // Start or stop tracing db, the connection must not be in use by another thread unless opened with SQLITE_OPEN_FULLMUTEX
+    void attach(sqlite3* db) noexcept;
+    static void detach(sqlite3* db) noexcept;
+
+    void set_slow_query(std::chrono::nanoseconds threshold, slow_query_callback callback);
+
+    // Sorted by total time, slowest first
+    std::vector<statement_stats> stats() const;
+
+    void reset() noexcept;
+
+    static std::string normalize(std::string_view sql);
+
+private:
+    struct entry final
+    {
+        uint64_t count = 0;
+        uint64_t rows = 0;
+        uint64_t total_ns = 0;
+        uint64_t max_ns = 0;
+        std::vector<uint64_t> samples; // ring buffer
+    };
+
+    mutable std::mutex m;
+    std::map<std::string, entry, std::less<>> entries; // normalized SQL -> timings
+    std::unordered_map<std::string, entry*> raw; // sqlite3_sql() text -> entry, saves normalizing again
+
+    std::chrono::nanoseconds threshold{0};
+    slow_query_callback slow;
+
+    static int trace(unsigned type, void* ctx, void* p, void* x) noexcept;
+    void record(sqlite3_stmt* stmt, uint64_t ns, uint64_t rows) noexcept;
+};
+
+}
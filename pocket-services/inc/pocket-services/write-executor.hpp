@@ -0,0 +1,191 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include "pocket/globals.hpp"
+#include "pocket-services/mpsc-queue.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <future>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace pocket::services::inline v5
+{
+
+class database;
+
+// Single writer thread for database. Jobs are queued lock-free from any thread and every batch
+// of jobs arrived within the group commit window runs in one transaction, each job in its own savepoint.
+// A future is resolved only after the transaction that contains its job has been committed.
+class write_executor final
+{
+public:
+    using ptr = std::unique_ptr<write_executor>;
+
+    static inline constexpr std::chrono::microseconds DEFAULT_WINDOW{2'000};
+    static inline constexpr size_t DEFAULT_MAX_BATCH = 256;
+
+    struct job : public mpsc_queue::node
+    {
+        virtual ~job() = default;
+        virtual void run(database& db) = 0;
+        virtual void complete() noexcept = 0;
+        virtual void fail(std::exception_ptr e) noexcept = 0;
+    };
+
+    template<typename F>
+    class task final : public job
+    {
+        using result = std::invoke_result_t<F, database&>;
+
+        F f;
+        std::promise<result> promise;
+        std::conditional_t<std::is_void_v<result>, std::monostate, std::optional<result>> value;
+    public:
+        explicit task(F&& f)
+        : f(std::forward<F>(f))
+        {}
+
+        inline std::future<result> get_future()
+        {
+            return promise.get_future();
+        }
+
+        void run(database& db) override
+        {
+            if constexpr (std::is_void_v<result>)
+            {
+                f(db);
+            }
+            else
+            {
+                value.emplace(f(db));
+            }
+        }
+
+        void complete() noexcept override
+        {
+            if constexpr (std::is_void_v<result>)
+            {
+                promise.set_value();
+            }
+            else
+            {
+                promise.set_value(std::move(*value));
+            }
+        }
+
+        void fail(std::exception_ptr e) noexcept override
+        {
+            promise.set_exception(e);
+        }
+    };
+
+    explicit write_executor(database& db, std::chrono::microseconds window = DEFAULT_WINDOW, size_t max_batch = DEFAULT_MAX_BATCH);
+    ~write_executor();
+    POCKET_NO_COPY_NO_MOVE(write_executor)
+
+    // Queue f(database&) on the writer thread. Not from inside a job nor from a thread that owns a
+    // database::transaction: waiting on the future there never returns, asserted in debug builds
+    template<typename F>
+    auto submit(F&& f) -> std::future<std::invoke_result_t<std::decay_t<F>, database&>>
+    {
+        check_caller();
+
+        // Seen by stop() before its last drain, or this sees stopping
+        submitting.fetch_add(1);
+        if(stopping)
+        {
+            leave();
+            throw std::runtime_error("Write executor stopped");
+        }
+
+        auto t = new task<std::decay_t<F>>(std::forward<F>(f));
+        auto ret = t->get_future();
+        queue.push(t);
+        pending.fetch_add(1, std::memory_order_release);
+        signal.fetch_add(1, std::memory_order_release);
+        signal.notify_one();
+        leave();
+        return ret;
+    }
+
+    // Run f(database&) synchronously on the calling thread in its own transaction
+    template<typename F>
+    static auto run(database& db, F&& f) -> std::future<std::invoke_result_t<std::decay_t<F>, database&>>
+    {
+        auto t = new task<std::decay_t<F>>(std::forward<F>(f));
+        auto ret = t->get_future();
+        std::vector<job*> batch{t};
+        execute(db, batch);
+        return ret;
+    }
+
+    // Join the writer thread, wait for the submit() calls in progress and run what they queued
+    void stop();
+
+    inline uint64_t get_batches() const noexcept
+    {
+        return batches;
+    }
+
+    inline uint64_t get_jobs() const noexcept
+    {
+        return jobs;
+    }
+
+private:
+    database& db;
+    std::chrono::microseconds window;
+    size_t max_batch;
+
+    mpsc_queue queue;
+    std::atomic<uint64_t> pending = 0;
+    std::atomic<uint64_t> signal = 0;
+    std::atomic<bool> stopping = false;
+    std::atomic<uint32_t> submitting = 0; // submit() calls in progress
+    std::atomic<uint64_t> batches = 0;
+    std::atomic<uint64_t> jobs = 0;
+    std::thread worker;
+
+    void loop();
+    void collect(std::vector<job*>& batch);
+    void check_caller() const noexcept;
+
+    inline void leave() noexcept
+    {
+        submitting.fetch_sub(1);
+        submitting.notify_all();
+    }
+
+    // Run and resolve every job of batch, then delete them
+    static void execute(database& db, std::vector<job*>& batch) noexcept;
+};
+
+}
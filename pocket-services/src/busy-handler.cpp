@@ -0,0 +1,112 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#include "pocket-services/busy-handler.hpp"
+
+#include <algorithm>
+#include <random>
+#include <thread>
+
+namespace pocket::services::inline v5
+{
+
+using namespace std;
+using namespace std::chrono;
+
+namespace
+{
+
+// A connection is stepped by one thread at a time, so the wait in progress is per thread
+thread_local steady_clock::time_point busy_started;
+thread_local optional<steady_clock::time_point> call_deadline;
+
+}
+
+busy_handler::deadline_scope::deadline_scope(steady_clock::duration budget) noexcept
+: previous(call_deadline)
+{
+    auto deadline = steady_clock::now() + budget;
+    // A nested scope can only shorten the outer deadline
+    call_deadline = previous ? min(*previous, deadline) : deadline;
+}
+
+busy_handler::deadline_scope::~deadline_scope()
+{
+    call_deadline = previous;
+}
+
+busy_handler::busy_handler(milliseconds timeout) noexcept
+: timeout(timeout)
+{
+
+}
+
+void busy_handler::install(sqlite3* handle) noexcept
+{
+    sqlite3_busy_handler(handle, on_busy, this);
+}
+
+busy_handler::metrics busy_handler::get_metrics() const noexcept
+{
+    return {
+        .events = events,
+        .retries = retries,
+        .timeouts = timeouts,
+        .wait = nanoseconds(wait_ns.load())
+    };
+}
+
+void busy_handler::reset_metrics() noexcept
+{
+    events = 0;
+    retries = 0;
+    timeouts = 0;
+    wait_ns = 0;
+}
+
+int busy_handler::on_busy(void* ctx, int count) noexcept
+{
+    auto self = static_cast<busy_handler*>(ctx);
+    auto now = steady_clock::now();
+    if(count == 0)
+    {
+        busy_started = now;
+        self->events++;
+    }
+
+    auto deadline = call_deadline ? *call_deadline : busy_started + self->timeout.load();
+    if(now >= deadline)
+    {
+        self->timeouts++;
+        return 0;
+    }
+
+    // Full jitter in [backoff / 2, backoff] keeps contending threads from waking up together
+    thread_local minstd_rand random{static_cast<uint_fast32_t>(hash<thread::id>{}(this_thread::get_id()))};
+    auto backoff = min<microseconds>(MIN_BACKOFF * (int64_t{1} << min(count, 16)), MAX_BACKOFF);
+    auto jittered = microseconds(uniform_int_distribution<int64_t>(backoff.count() / 2, backoff.count())(random));
+    auto sleep = min<steady_clock::duration>(jittered, deadline - now);
+
+    this_thread::sleep_for(sleep);
+    self->retries++;
+    self->wait_ns += duration_cast<nanoseconds>(steady_clock::now() - now).count();
+    return 1;
+}
+
+}
@@ -0,0 +1,156 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+
+#include "pocket-services/connection-pool.hpp"
+
+#include <stdexcept>
+
+namespace pocket::services::inline v5
+{
+
+using namespace std;
+
+connection_pool::lease::lease(lease&& other) noexcept
+: pool(other.pool)
+, conn(other.conn)
+{
+    other.pool = nullptr;
+    other.conn = nullptr;
+}
+
+connection_pool::lease::~lease()
+{
+    if(pool && conn)
+    {
+        pool->release(conn);
+    }
+}
+
+connection_pool::~connection_pool()
+{
+    close();
+}
+
+void connection_pool::open(const string& file_db_path, size_t max_size, busy_handler* busy, const string& pragmas, const char* vfs, setup on_open) noexcept
+{
+    lock_guard<mutex> lg(m);
+    this->on_open = std::move(on_open);
+    this->file_db_path = file_db_path;
+    this->pragmas = pragmas;
+    this->vfs = vfs ? vfs : "";
+    this->max_size = max_size;
+    this->busy = busy;
+}
+
+void connection_pool::close() noexcept
+{
+    unique_lock<mutex> ul(m);
+    cv.wait(ul, [this] { return idle.size() == connections.size(); });
+
+    for(auto&& conn : connections)
+    {
+        conn->statements.clear();
+        sqlite3_close_v2(conn->db);
+        conn->db = nullptr;
+    }
+    idle.clear();
+    connections.clear();
+    max_size = 0;
+}
+
+connection_pool::lease connection_pool::acquire()
+{
+    unique_lock<mutex> ul(m);
+    if(max_size == 0)
+    {
+        throw runtime_error("Read pool not open");
+    }
+
+    cv.wait(ul, [this] { return !idle.empty() || connections.size() < max_size; });
+
+    if(!idle.empty())
+    {
+        auto conn = idle.back();
+        idle.pop_back();
+        if(conn->profiler != profiler)
+        {
+            // Idle, so no other thread is stepping on it
+            profiler ? profiler->attach(conn->db) : statement_profiler::detach(conn->db);
+            conn->profiler = profiler;
+        }
+        return {this, conn};
+    }
+
+    auto conn = make_unique<connection>();
+    if(int rc = sqlite3_open_v2(file_db_path.c_str(), &conn->db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, vfs.empty() ? nullptr : vfs.c_str()); rc != SQLITE_OK)
+    {
+        string msg = "Error opening read connection: ";
+        msg += sqlite3_errmsg(conn->db);
+        sqlite3_close(conn->db);
+        throw runtime_error(msg);
+    }
+    if(busy)
+    {
+        busy->install(conn->db);
+    }
+    if(!pragmas.empty())
+    {
+        if(int rc = sqlite3_exec(conn->db, pragmas.c_str(), nullptr, nullptr, nullptr); rc != SQLITE_OK)
+        {
+            error(typeid(*this).name(), "Error setting read connection options: " + string(sqlite3_errmsg(conn->db)));
+        }
+    }
+    if(on_open)
+    {
+        on_open(conn->db);
+    }
+    if(profiler)
+    {
+        profiler->attach(conn->db);
+        conn->profiler = profiler;
+    }
+
+    connections.push_back(std::move(conn));
+    debug(typeid(*this).name(), "Open read connection " + to_string(connections.size()) + "/" + to_string(max_size));
+    return {this, connections.back().get()};
+}
+
+size_t connection_pool::size() const noexcept
+{
+    lock_guard<mutex> lg(m);
+    return connections.size();
+}
+
+void connection_pool::set_profiler(statement_profiler* profiler) noexcept
+{
+    lock_guard<mutex> lg(m);
+    this->profiler = profiler;
+}
+
+void connection_pool::release(connection* conn) noexcept
+{
+    {
+        lock_guard<mutex> lg(m);
+        idle.push_back(conn);
+    }
+    cv.notify_one();
+}
+
+}
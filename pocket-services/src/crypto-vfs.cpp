@@ -0,0 +1,740 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#include "pocket-services/crypto-vfs.hpp"
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include <sqlite3.h>
+
+namespace pocket::services::inline v5
+{
+
+using namespace std;
+
+namespace
+{
+
+constexpr int64_t SECTOR_SIZE = crypto_vfs::SECTOR_SIZE;
+constexpr int64_t NONCE_SIZE = crypto_vfs::NONCE_SIZE;
+
+// SQLite starts a WAL or a journal over writing its whole header at offset 0: 32 bytes for a WAL,
+// at least 28 for a journal. The 12 bytes rewrite of magic and record count of a journal header keeps the nonce.
+constexpr int STREAM_HEADER_SIZE = 28;
+
+struct file_keys final
+{
+    uint8_t xts[64]{0}; // two AES-256 keys, data and tweak
+    uint8_t ctr[32]{0};
+
+    ~file_keys()
+    {
+        OPENSSL_cleanse(this, sizeof(*this));
+    }
+};
+
+enum class cipher : uint8_t
+{
+    NONE = 0,
+    PAGES, // main database, AES-256-XTS per sector
+    STREAM // journal and WAL, AES-256-CTR by nonce and offset
+};
+
+// Laid out as SQLite expects: the sqlite3_file first, the file of the underlying VFS after the struct
+struct crypto_file final
+{
+    sqlite3_file base;
+    sqlite3_file* real;
+    shared_ptr<const file_keys>* keys;
+    cipher kind;
+};
+
+sqlite3_vfs vfs{};
+once_flag vfs_once;
+
+mutex keys_m;
+unordered_map<string, shared_ptr<const file_keys>> keys_by_path;
+
+struct cipher_ctx_deleter final
+{
+    void operator()(EVP_CIPHER_CTX* ctx) const noexcept
+    {
+        EVP_CIPHER_CTX_free(ctx);
+    }
+};
+
+// One context per thread, the key schedule is set up once per read or write
+EVP_CIPHER_CTX* thread_ctx()
+{
+    thread_local unique_ptr<EVP_CIPHER_CTX, cipher_ctx_deleter> ctx(EVP_CIPHER_CTX_new());
+    if(ctx == nullptr)
+    {
+        throw bad_alloc();
+    }
+    return ctx.get();
+}
+
+// Ciphertext of a write, the caller's buffer is const
+vector<uint8_t>& thread_buffer(size_t size)
+{
+    thread_local vector<uint8_t> buffer;
+    if(buffer.size() < size)
+    {
+        buffer.resize(size);
+    }
+    return buffer;
+}
+
+inline sqlite3_vfs* root_vfs(sqlite3_vfs* v) noexcept
+{
+    return static_cast<sqlite3_vfs*>(v->pAppData);
+}
+
+inline crypto_file* to_crypto_file(sqlite3_file* f) noexcept
+{
+    return reinterpret_cast<crypto_file*>(f);
+}
+
+string full_path(const string& path)
+{
+    crypto_vfs::install();
+    auto root = root_vfs(&vfs);
+    string ret(root->mxPathname + 1, '\0');
+    // SQLITE_OK_SYMLINK is a success too
+    if((root->xFullPathname(root, path.c_str(), static_cast<int>(ret.size()), ret.data()) & 0xff) != SQLITE_OK)
+    {
+        return path;
+    }
+    ret.resize(strlen(ret.c_str()));
+    return ret;
+}
+
+shared_ptr<const file_keys> find_keys(const char* file_db_path)
+{
+    if(file_db_path == nullptr)
+    {
+        return nullptr;
+    }
+    lock_guard<mutex> lg(keys_m);
+    if(auto&& it = keys_by_path.find(file_db_path); it != keys_by_path.end())
+    {
+        return it->second;
+    }
+    return nullptr;
+}
+
+// Encrypt or decrypt whole sectors, in may be out
+bool xts_apply(const file_keys& keys, const uint8_t* in, uint8_t* out, int64_t len, int64_t ofst, bool encrypt)
+{
+    auto ctx = thread_ctx();
+    if(EVP_CipherInit_ex(ctx, EVP_aes_256_xts(), nullptr, keys.xts, nullptr, encrypt) != 1)
+    {
+        return false;
+    }
+
+    for(int64_t done = 0; done < len; done += SECTOR_SIZE)
+    {
+        // Little endian sector number, as for disk encryption
+        uint8_t tweak[16]{0};
+        auto sector = static_cast<uint64_t>((ofst + done) / SECTOR_SIZE);
+        for(size_t i = 0; i < sizeof(sector); i++)
+        {
+            tweak[i] = static_cast<uint8_t>(sector >> (8 * i));
+        }
+
+        int out_len = 0;
+        if(EVP_CipherInit_ex(ctx, nullptr, nullptr, nullptr, tweak, encrypt) != 1
+            || EVP_CipherUpdate(ctx, out + done, &out_len, in + done, SECTOR_SIZE) != 1)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// XOR with the keystream of nonce at ofst, the same call encrypts and decrypts
+bool ctr_apply(const file_keys& keys, const uint8_t* nonce, const uint8_t* in, uint8_t* out, int64_t len, int64_t ofst)
+{
+    uint8_t iv[16]{0};
+    memcpy(iv, nonce, NONCE_SIZE);
+    auto block = static_cast<uint64_t>(ofst / 16);
+    for(size_t i = 0; i < sizeof(block); i++)
+    {
+        iv[15 - i] = static_cast<uint8_t>(block >> (8 * i));
+    }
+
+    auto ctx = thread_ctx();
+    if(EVP_EncryptInit_ex(ctx, EVP_aes_256_ctr(), nullptr, keys.ctr, iv) != 1)
+    {
+        return false;
+    }
+
+    int out_len = 0;
+    if(auto skip = static_cast<int>(ofst % 16); skip > 0)
+    {
+        uint8_t discard[16]{0};
+        if(EVP_EncryptUpdate(ctx, discard, &out_len, discard, skip) != 1)
+        {
+            return false;
+        }
+    }
+    return EVP_EncryptUpdate(ctx, out, &out_len, in, static_cast<int>(len)) == 1;
+}
+
+// Read the sectors in [first, first + len) and decrypt them, what is past the end of the file reads as zeros
+int read_sectors(crypto_file* f, uint8_t* out, int64_t first, int64_t len)
+{
+    int rc = f->real->pMethods->xRead(f->real, out, static_cast<int>(len), first);
+    int64_t valid = len;
+    if(rc == SQLITE_IOERR_SHORT_READ)
+    {
+        sqlite3_int64 size = 0;
+        if(f->real->pMethods->xFileSize(f->real, &size) != SQLITE_OK)
+        {
+            return SQLITE_IOERR_READ;
+        }
+        valid = max<int64_t>(0, (size - first) / SECTOR_SIZE * SECTOR_SIZE);
+        memset(out + valid, 0, len - valid);
+    }
+    else if(rc != SQLITE_OK)
+    {
+        return rc;
+    }
+
+    if(!xts_apply(**f->keys, out, out, valid, first, false))
+    {
+        return SQLITE_IOERR_READ;
+    }
+    return rc;
+}
+
+// Nonce of the current content of a journal or WAL, SQLITE_IOERR_SHORT_READ when the file is empty
+int read_nonce(crypto_file* f, uint8_t* nonce)
+{
+    return f->real->pMethods->xRead(f->real, nonce, NONCE_SIZE, 0);
+}
+
+int file_close(sqlite3_file* file)
+{
+    auto f = to_crypto_file(file);
+    int rc = f->real->pMethods->xClose(f->real);
+    delete f->keys;
+    f->keys = nullptr;
+    return rc;
+}
+
+int file_read(sqlite3_file* file, void* buf, int amt, sqlite3_int64 ofst) try
+{
+    auto f = to_crypto_file(file);
+    auto out = static_cast<uint8_t*>(buf);
+    switch(f->kind)
+    {
+    case cipher::PAGES:
+    {
+        auto first = ofst / SECTOR_SIZE * SECTOR_SIZE;
+        auto last = (ofst + amt + SECTOR_SIZE - 1) / SECTOR_SIZE * SECTOR_SIZE;
+        if(first == ofst && last == ofst + amt)
+        {
+            return read_sectors(f, out, first, amt);
+        }
+
+        // Partial sectors, e.g. the 100 bytes header of the database
+        auto&& buffer = thread_buffer(last - first);
+        int rc = read_sectors(f, buffer.data(), first, last - first);
+        if(rc == SQLITE_OK || rc == SQLITE_IOERR_SHORT_READ)
+        {
+            memcpy(out, buffer.data() + (ofst - first), amt);
+        }
+        return rc;
+    }
+    case cipher::STREAM:
+    {
+        // Read again on every call: another connection may have started the file over
+        uint8_t nonce[NONCE_SIZE];
+        if(int rc = read_nonce(f, nonce); rc == SQLITE_IOERR_SHORT_READ)
+        {
+            memset(out, 0, amt);
+            return rc;
+        }
+        else if(rc != SQLITE_OK)
+        {
+            return rc;
+        }
+
+        int rc = f->real->pMethods->xRead(f->real, out, amt, ofst + NONCE_SIZE);
+        int64_t valid = amt;
+        if(rc == SQLITE_IOERR_SHORT_READ)
+        {
+            // Only the bytes before the end of the file, the rest stays zero filled
+            sqlite3_int64 size = 0;
+            if(f->real->pMethods->xFileSize(f->real, &size) != SQLITE_OK)
+            {
+                return SQLITE_IOERR_READ;
+            }
+            valid = clamp<int64_t>(size - NONCE_SIZE - ofst, 0, amt);
+        }
+        else if(rc != SQLITE_OK)
+        {
+            return rc;
+        }
+
+        if(!ctr_apply(**f->keys, nonce, out, out, valid, ofst))
+        {
+            return SQLITE_IOERR_READ;
+        }
+        return rc;
+    }
+    default:
+        return f->real->pMethods->xRead(f->real, buf, amt, ofst);
+    }
+}
+catch (const bad_alloc&)
+{
+    return SQLITE_IOERR_NOMEM;
+}
+
+int file_write(sqlite3_file* file, const void* buf, int amt, sqlite3_int64 ofst) try
+{
+    auto f = to_crypto_file(file);
+    auto in = static_cast<const uint8_t*>(buf);
+    switch(f->kind)
+    {
+    case cipher::PAGES:
+    {
+        auto first = ofst / SECTOR_SIZE * SECTOR_SIZE;
+        auto last = (ofst + amt + SECTOR_SIZE - 1) / SECTOR_SIZE * SECTOR_SIZE;
+        auto&& buffer = thread_buffer(last - first);
+        if(first != ofst || last != ofst + amt)
+        {
+            // SQLite writes whole pages to the database file, this read-modify-write is only a fallback
+            if(int rc = read_sectors(f, buffer.data(), first, last - first); rc != SQLITE_OK && rc != SQLITE_IOERR_SHORT_READ)
+            {
+                return rc;
+            }
+        }
+        memcpy(buffer.data() + (ofst - first), in, amt);
+        if(!xts_apply(**f->keys, buffer.data(), buffer.data(), last - first, first, true))
+        {
+            return SQLITE_IOERR_WRITE;
+        }
+        return f->real->pMethods->xWrite(f->real, buffer.data(), static_cast<int>(last - first), first);
+    }
+    case cipher::STREAM:
+    {
+        uint8_t nonce[NONCE_SIZE];
+        bool fresh = ofst == 0 && amt >= STREAM_HEADER_SIZE;
+        if(!fresh)
+        {
+            if(int rc = read_nonce(f, nonce); rc == SQLITE_IOERR_SHORT_READ)
+            {
+                fresh = true;
+            }
+            else if(rc != SQLITE_OK)
+            {
+                return rc;
+            }
+        }
+        if(fresh && RAND_bytes(nonce, NONCE_SIZE) != 1)
+        {
+            return SQLITE_IOERR_WRITE;
+        }
+
+        // At offset 0 nonce and content go in one write, a torn write can not pair them wrong
+        auto&& buffer = thread_buffer(NONCE_SIZE + amt);
+        memcpy(buffer.data(), nonce, NONCE_SIZE);
+        if(!ctr_apply(**f->keys, nonce, in, buffer.data() + NONCE_SIZE, amt, ofst))
+        {
+            return SQLITE_IOERR_WRITE;
+        }
+        if(ofst == 0)
+        {
+            return f->real->pMethods->xWrite(f->real, buffer.data(), static_cast<int>(NONCE_SIZE + amt), 0);
+        }
+        if(fresh)
+        {
+            if(int rc = f->real->pMethods->xWrite(f->real, nonce, NONCE_SIZE, 0); rc != SQLITE_OK)
+            {
+                return rc;
+            }
+        }
+        return f->real->pMethods->xWrite(f->real, buffer.data() + NONCE_SIZE, amt, ofst + NONCE_SIZE);
+    }
+    default:
+        return f->real->pMethods->xWrite(f->real, buf, amt, ofst);
+    }
+}
+catch (const bad_alloc&)
+{
+    return SQLITE_IOERR_NOMEM;
+}
+
+int file_truncate(sqlite3_file* file, sqlite3_int64 size)
+{
+    auto f = to_crypto_file(file);
+    if(f->kind == cipher::STREAM && size > 0)
+    {
+        size += NONCE_SIZE;
+    }
+    return f->real->pMethods->xTruncate(f->real, size);
+}
+
+int file_sync(sqlite3_file* file, int flags)
+{
+    auto f = to_crypto_file(file);
+    return f->real->pMethods->xSync(f->real, flags);
+}
+
+int file_size(sqlite3_file* file, sqlite3_int64* size)
+{
+    auto f = to_crypto_file(file);
+    int rc = f->real->pMethods->xFileSize(f->real, size);
+    if(rc == SQLITE_OK && f->kind == cipher::STREAM)
+    {
+        *size = max<sqlite3_int64>(0, *size - NONCE_SIZE);
+    }
+    return rc;
+}
+
+int file_lock(sqlite3_file* file, int lock)
+{
+    auto f = to_crypto_file(file);
+    return f->real->pMethods->xLock(f->real, lock);
+}
+
+int file_unlock(sqlite3_file* file, int lock)
+{
+    auto f = to_crypto_file(file);
+    return f->real->pMethods->xUnlock(f->real, lock);
+}
+
+int file_check_reserved_lock(sqlite3_file* file, int* out)
+{
+    auto f = to_crypto_file(file);
+    return f->real->pMethods->xCheckReservedLock(f->real, out);
+}
+
+int file_control(sqlite3_file* file, int op, void* arg)
+{
+    auto f = to_crypto_file(file);
+    return f->real->pMethods->xFileControl(f->real, op, arg);
+}
+
+int file_sector_size(sqlite3_file* file)
+{
+    auto f = to_crypto_file(file);
+    return f->real->pMethods->xSectorSize(f->real);
+}
+
+int file_device_characteristics(sqlite3_file* file)
+{
+    auto f = to_crypto_file(file);
+    return f->real->pMethods->xDeviceCharacteristics(f->real);
+}
+
+// The wal-index holds page numbers and checksums only, it is shared memory of the underlying VFS
+int file_shm_map(sqlite3_file* file, int page, int page_size, int extend, void volatile** out)
+{
+    auto f = to_crypto_file(file);
+    return f->real->pMethods->xShmMap(f->real, page, page_size, extend, out);
+}
+
+int file_shm_lock(sqlite3_file* file, int offset, int n, int flags)
+{
+    auto f = to_crypto_file(file);
+    return f->real->pMethods->xShmLock(f->real, offset, n, flags);
+}
+
+void file_shm_barrier(sqlite3_file* file)
+{
+    auto f = to_crypto_file(file);
+    f->real->pMethods->xShmBarrier(f->real);
+}
+
+int file_shm_unmap(sqlite3_file* file, int delete_flag)
+{
+    auto f = to_crypto_file(file);
+    return f->real->pMethods->xShmUnmap(f->real, delete_flag);
+}
+
+int file_fetch(sqlite3_file* file, sqlite3_int64 ofst, int amt, void** out)
+{
+    auto f = to_crypto_file(file);
+    if(f->kind != cipher::NONE || f->real->pMethods->iVersion < 3)
+    {
+        // Mapped pages would be ciphertext, SQLite falls back to xRead
+        *out = nullptr;
+        return SQLITE_OK;
+    }
+    return f->real->pMethods->xFetch(f->real, ofst, amt, out);
+}
+
+int file_unfetch(sqlite3_file* file, sqlite3_int64 ofst, void* p)
+{
+    auto f = to_crypto_file(file);
+    if(f->real->pMethods->iVersion < 3)
+    {
+        return SQLITE_OK;
+    }
+    return f->real->pMethods->xUnfetch(f->real, ofst, p);
+}
+
+const sqlite3_io_methods io_methods{
+    3,
+    file_close,
+    file_read,
+    file_write,
+    file_truncate,
+    file_sync,
+    file_size,
+    file_lock,
+    file_unlock,
+    file_check_reserved_lock,
+    file_control,
+    file_sector_size,
+    file_device_characteristics,
+    file_shm_map,
+    file_shm_lock,
+    file_shm_barrier,
+    file_shm_unmap,
+    file_fetch,
+    file_unfetch
+};
+
+int vfs_open(sqlite3_vfs* v, sqlite3_filename name, sqlite3_file* file, int flags, int* out_flags) try
+{
+    auto root = root_vfs(v);
+    auto f = to_crypto_file(file);
+    f->base.pMethods = nullptr;
+    f->real = reinterpret_cast<sqlite3_file*>(f + 1);
+    f->keys = nullptr;
+    f->kind = cipher::NONE;
+
+    if(int rc = root->xOpen(root, name, f->real, flags, out_flags); rc != SQLITE_OK)
+    {
+        return rc;
+    }
+
+    // Temporary files have no name and are not tied to a database
+    shared_ptr<const file_keys> keys;
+    if(flags & SQLITE_OPEN_MAIN_DB)
+    {
+        keys = find_keys(name);
+        f->kind = cipher::PAGES;
+    }
+    else if(flags & (SQLITE_OPEN_MAIN_JOURNAL | SQLITE_OPEN_WAL))
+    {
+        keys = find_keys(name ? sqlite3_filename_database(name) : nullptr);
+        f->kind = cipher::STREAM;
+    }
+
+    if(keys)
+    {
+        f->keys = new shared_ptr<const file_keys>(std::move(keys));
+    }
+    else
+    {
+        f->kind = cipher::NONE;
+    }
+    f->base.pMethods = &io_methods;
+    return SQLITE_OK;
+}
+catch (const bad_alloc&)
+{
+    auto f = to_crypto_file(file);
+    f->real->pMethods->xClose(f->real);
+    return SQLITE_NOMEM;
+}
+
+int vfs_delete(sqlite3_vfs* v, const char* name, int sync_dir)
+{
+    auto root = root_vfs(v);
+    return root->xDelete(root, name, sync_dir);
+}
+
+int vfs_access(sqlite3_vfs* v, const char* name, int flags, int* out)
+{
+    auto root = root_vfs(v);
+    return root->xAccess(root, name, flags, out);
+}
+
+int vfs_full_pathname(sqlite3_vfs* v, const char* name, int size, char* out)
+{
+    auto root = root_vfs(v);
+    return root->xFullPathname(root, name, size, out);
+}
+
+void* vfs_dl_open(sqlite3_vfs* v, const char* name)
+{
+    auto root = root_vfs(v);
+    return root->xDlOpen(root, name);
+}
+
+void vfs_dl_error(sqlite3_vfs* v, int size, char* out)
+{
+    auto root = root_vfs(v);
+    root->xDlError(root, size, out);
+}
+
+void (*vfs_dl_sym(sqlite3_vfs* v, void* handle, const char* symbol))(void)
+{
+    auto root = root_vfs(v);
+    return root->xDlSym(root, handle, symbol);
+}
+
+void vfs_dl_close(sqlite3_vfs* v, void* handle)
+{
+    auto root = root_vfs(v);
+    root->xDlClose(root, handle);
+}
+
+int vfs_randomness(sqlite3_vfs* v, int size, char* out)
+{
+    auto root = root_vfs(v);
+    return root->xRandomness(root, size, out);
+}
+
+int vfs_sleep(sqlite3_vfs* v, int microseconds)
+{
+    auto root = root_vfs(v);
+    return root->xSleep(root, microseconds);
+}
+
+int vfs_current_time(sqlite3_vfs* v, double* out)
+{
+    auto root = root_vfs(v);
+    return root->xCurrentTime(root, out);
+}
+
+int vfs_get_last_error(sqlite3_vfs* v, int size, char* out)
+{
+    auto root = root_vfs(v);
+    return root->xGetLastError ? root->xGetLastError(root, size, out) : 0;
+}
+
+int vfs_current_time_int64(sqlite3_vfs* v, sqlite3_int64* out)
+{
+    auto root = root_vfs(v);
+    return root->xCurrentTimeInt64(root, out);
+}
+
+void derive_key(const string_view& label, const string_view& key, uint8_t out[64])
+{
+    string material;
+    material.reserve(label.size() + key.size());
+    material.append(label).append(key);
+
+    unsigned int out_len = 0;
+    bool ok = EVP_Digest(material.data(), material.size(), out, &out_len, EVP_sha512(), nullptr) == 1;
+    OPENSSL_cleanse(material.data(), material.size());
+    if(!ok)
+    {
+        throw runtime_error("Impossible derive the database key");
+    }
+}
+
+}
+
+void crypto_vfs::install()
+{
+    call_once(vfs_once, []
+    {
+        auto root = sqlite3_vfs_find(nullptr);
+        if(root == nullptr || root->iVersion < 2)
+        {
+            throw runtime_error("No default sqlite3 VFS to encrypt");
+        }
+
+        vfs.iVersion = 2;
+        vfs.szOsFile = static_cast<int>(sizeof(crypto_file)) + root->szOsFile;
+        vfs.mxPathname = root->mxPathname;
+        vfs.zName = NAME;
+        vfs.pAppData = root;
+        vfs.xOpen = vfs_open;
+        vfs.xDelete = vfs_delete;
+        vfs.xAccess = vfs_access;
+        vfs.xFullPathname = vfs_full_pathname;
+        vfs.xDlOpen = vfs_dl_open;
+        vfs.xDlError = vfs_dl_error;
+        vfs.xDlSym = vfs_dl_sym;
+        vfs.xDlClose = vfs_dl_close;
+        vfs.xRandomness = vfs_randomness;
+        vfs.xSleep = vfs_sleep;
+        vfs.xCurrentTime = vfs_current_time;
+        vfs.xGetLastError = vfs_get_last_error;
+        vfs.xCurrentTimeInt64 = vfs_current_time_int64;
+
+        if(int rc = sqlite3_vfs_register(&vfs, 0); rc != SQLITE_OK)
+        {
+            throw runtime_error("Impossible register VFS " + string(NAME) + ": " + sqlite3_errstr(rc));
+        }
+    });
+}
+
+void crypto_vfs::set_key(const string& file_db_path, const string_view& key)
+{
+    if(key.empty())
+    {
+        throw runtime_error("Empty database key");
+    }
+
+    auto keys = make_shared<file_keys>();
+    derive_key("pocket-crypto-xts", key, keys->xts);
+    uint8_t ctr[64]{0};
+    derive_key("pocket-crypto-ctr", key, ctr);
+    memcpy(keys->ctr, ctr, sizeof(keys->ctr));
+    OPENSSL_cleanse(ctr, sizeof(ctr));
+
+    auto path = full_path(file_db_path);
+    lock_guard<mutex> lg(keys_m);
+    // Files already open keep the keys they were opened with
+    keys_by_path[path] = std::move(keys);
+}
+
+void crypto_vfs::remove_key(const string& file_db_path) noexcept try
+{
+    auto path = full_path(file_db_path);
+    lock_guard<mutex> lg(keys_m);
+    keys_by_path.erase(path);
+}
+catch (...)
+{
+}
+
+bool crypto_vfs::has_key(const string& file_db_path) noexcept try
+{
+    auto path = full_path(file_db_path);
+    lock_guard<mutex> lg(keys_m);
+    return keys_by_path.contains(path);
+}
+catch (...)
+{
+    return false;
+}
+
+}
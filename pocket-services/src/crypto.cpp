@@ -272,7 +272,8 @@ string crypto_generate_random_string(size_t length)
 }
 
 
-aes::aes(const string_view& iv, const string_view& key)
+aes::aes(const string_view& iv, const string_view& key, bool raw)
+: raw(raw)
 {
     if (iv.length() != AES_BLOCK_SIZE)
     {
@@ -363,7 +364,7 @@ std::string aes::encrypt(const string_view& plain, bool url_compliant) const
     }
     cipher_text_len += len;
 
-    auto&& ret = crypto_base64_encode(cipher_text, cipher_text_len, url_compliant);
+    auto&& ret = raw ? string(reinterpret_cast<char*>(cipher_text), cipher_text_len) : crypto_base64_encode(cipher_text, cipher_text_len, url_compliant);
 
     delete[] cipher_text;
 
@@ -379,7 +380,7 @@ std::string aes::decrypt(const string_view& encrypted, bool url_compliant) const
         return  "";
     }
 
-    auto&& cipher = crypto_base64_decode(string{encrypted}, url_compliant);
+    auto&& cipher = raw ? vector<uint8_t>(encrypted.begin(), encrypted.end()) : crypto_base64_decode(string{encrypted}, url_compliant);
 
     auto plain_text = new(nothrow) uint8_t[encrypted.size()];
     if(plain_text == nullptr)
@@ -0,0 +1,87 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+
+#include "pocket-services/cursor.hpp"
+
+namespace pocket::services::inline v5
+{
+
+using namespace std;
+using pods::variant;
+
+cursor::cursor(sqlite3_stmt* stmt)
+: stmt(stmt)
+{
+    auto count = sqlite3_column_count(stmt);
+    columns.reserve(count);
+    for(int i = 0; i < count; i++)
+    {
+        columns.emplace_back(sqlite3_column_name(stmt, i));
+    }
+}
+
+int cursor::column_index(string_view name) const noexcept
+{
+    for(int i = 0; i < static_cast<int>(columns.size()); i++)
+    {
+        if(columns[i] == name)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+string_view cursor::get_text(int i) const noexcept
+{
+    if(i < 0)
+    {
+        return {};
+    }
+    auto text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, i));
+    if(text == nullptr)
+    {
+        return {};
+    }
+    return {text, static_cast<size_t>(sqlite3_column_bytes(stmt, i))};
+}
+
+variant cursor::get_variant(int i) const
+{
+    if(i < 0)
+    {
+        return nullptr;
+    }
+    switch(sqlite3_column_type(stmt, i))
+    {
+        case SQLITE3_TEXT:
+            return string{get_text(i)};
+        case SQLITE_BLOB:
+            return variant::blob(string{get_text(i)});
+        case SQLITE_INTEGER:
+            return static_cast<int64_t>(sqlite3_column_int64(stmt, i));
+        case SQLITE_FLOAT:
+            return sqlite3_column_double(stmt, i);
+        default:
+            return nullptr;
+    }
+}
+
+}
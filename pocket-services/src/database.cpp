@@ -19,16 +19,22 @@
 
 #include "pocket-services/database.hpp"
 #include "pocket-services/result-set.hpp"
+#include "pocket-services/crypto.hpp"
+#include "pocket-services/crypto-vfs.hpp"
+#include "pocket-services/io-vfs.hpp"
 #include "pocket/globals.hpp"
 
+#include <algorithm>
 #include <stdexcept>
 #include <iostream>
 #include <vector>
 #include <sstream>
 #include <filesystem>
 #include <unistd.h>
+#include <strings.h>
 #include <thread>
 #include <chrono>
+#include <random>
 
 namespace pocket::services::inline v5
 {
@@ -38,6 +44,22 @@ using namespace std::filesystem;
 using pods::variant;
 using enum pods::variant::type;
 
+namespace
+{
+
+// Plain SELECTs can be served by the read pool, everything else goes to the writer connection
+bool is_read_query(const string& query) noexcept
+{
+    auto begin = query.find_first_not_of(" \t\r\n");
+    if(begin == string::npos || query.size() - begin < 6)
+    {
+        return false;
+    }
+    return strncasecmp(query.c_str() + begin, "SELECT", 6) == 0;
+}
+
+}
+
 char const database::CREATION_SQL[] = R"sql(
 CREATE TABLE `user` ( `id` INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT, `name` text NOT NULL, `email` text NOT NULL, `passwd` text NOT NULL, status integer NOT NULL DEFAULT '0', `timestamp_last_update` INTEGER NOT NULL DEFAULT 0);
 CREATE TABLE fields ( `id` integer PRIMARY KEY AUTOINCREMENT, user_id integer NOT NULL DEFAULT 0, server_id integer NOT NULL DEFAULT 0, `group_id` integer NOT NULL DEFAULT 0, `server_group_id` integer NOT NULL DEFAULT 0, `group_field_id` integer NOT NULL DEFAULT 0, `server_group_field_id` integer NOT NULL DEFAULT 0, `title` text NOT NULL, `value` text NOT NULL, `is_hidden` integer NOT NULL, synchronized integer NOT NULL DEFAULT 0, deleted integer NOT NULL DEFAULT '0', `timestamp_creation` INTEGER NOT NULL DEFAULT 0, FOREIGN KEY (user_id) REFERENCES user (id));
@@ -73,7 +95,109 @@ catch (const exception& e)
     error(typeid(*this).name(), e.what());
 }
 
-bool database::open(const string& file_db_path) 
+database::open_options database::open_options::mobile_low_memory() noexcept
+{
+    open_options ret;
+    ret.read_pool_size = 2;
+    ret.cache_size_kib = 1'024;
+    ret.mmap_size = 0;
+    ret.synchronous = synchronous_mode::NORMAL;
+    ret.temp_store_memory = false;
+    return ret;
+}
+
+database::open_options database::open_options::desktop_throughput() noexcept
+{
+    open_options ret;
+    ret.cache_size_kib = 64 * 1'024;
+    ret.mmap_size = 256 * 1'024 * 1'024;
+    ret.synchronous = synchronous_mode::NORMAL;
+    ret.temp_store_memory = true;
+    ret.page_size = 8'192;
+    return ret;
+}
+
+database::open_options database::open_options::read_mostly() noexcept
+{
+    open_options ret;
+    ret.read_pool_size = 8;
+    ret.cache_size_kib = 16 * 1'024;
+    ret.mmap_size = 128 * 1'024 * 1'024;
+    ret.synchronous = synchronous_mode::NORMAL;
+    ret.temp_store_memory = true;
+    return ret;
+}
+
+optional<database::open_options> database::open_options::preset(string_view name) noexcept
+{
+    if(name.empty() || name == "default")
+    {
+        return open_options{};
+    }
+    else if(name == "mobile_low_memory")
+    {
+        return mobile_low_memory();
+    }
+    else if(name == "desktop_throughput")
+    {
+        return desktop_throughput();
+    }
+    else if(name == "read_mostly")
+    {
+        return read_mostly();
+    }
+    return nullopt;
+}
+
+string database::open_options::pragmas(bool for_writer) const
+{
+    string ret;
+    if(for_writer && page_size)
+    {
+        ret += "PRAGMA page_size = " + to_string(*page_size) + ";";
+    }
+    if(for_writer && incremental_vacuum)
+    {
+        ret += "PRAGMA auto_vacuum = INCREMENTAL;";
+    }
+    if(cache_size_kib)
+    {
+        // Negative values are KiB instead of pages
+        ret += "PRAGMA cache_size = " + to_string(-*cache_size_kib) + ";";
+    }
+    if(mmap_size)
+    {
+        ret += "PRAGMA mmap_size = " + to_string(*mmap_size) + ";";
+    }
+    if(for_writer && synchronous)
+    {
+        ret += "PRAGMA synchronous = " + to_string(static_cast<int>(*synchronous)) + ";";
+    }
+    if(!encryption_key.empty())
+    {
+        // Temp files are not tied to the database file and crypto_vfs leaves them in clear
+        ret += "PRAGMA temp_store = MEMORY;";
+    }
+    else if(temp_store_memory)
+    {
+        ret += *temp_store_memory ? "PRAGMA temp_store = MEMORY;" : "PRAGMA temp_store = FILE;";
+    }
+    return ret;
+}
+
+bool database::open(const string& file_db_path)
+{
+    return open(file_db_path, open_options{});
+}
+
+bool database::open(const string& file_db_path, lock_mode mode)
+{
+    open_options options;
+    options.mode = mode;
+    return open(file_db_path, options);
+}
+
+bool database::open(const string& file_db_path, const open_options& options)
 {
     lock_guard<mutex> lg(m);
 
@@ -82,26 +206,75 @@ bool database::open(const string& file_db_path)
         throw runtime_error("sqlite3 is not thread safe");
     }
 
-    int rc = sqlite3_open_v2(file_db_path.c_str(), &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX, nullptr);
-    if(rc != SQLITE_OK)
+    const char* vfs = nullptr;
+    if(!options.encryption_key.empty())
     {
-        string msg = "Error opening database: ";
-        msg += sqlite3_errmsg(db);
-        sqlite3_close(db);
-        throw runtime_error(msg);
+        crypto_vfs::set_key(file_db_path, options.encryption_key); //throw exception
+        vfs = crypto_vfs::NAME;
+    }
+    io = nullptr;
+    if(options.io_stats)
+    {
+        // Stacked over crypto_vfs, when encrypted, whose time is part of the latencies
+        io = make_shared<io_monitor>();
+        io_vfs::attach(file_db_path, io);
+        vfs = io_vfs::install(vfs); //throw exception
     }
+    vfs_name = vfs ? vfs : "";
 
-    // Set busy timeout to X seconds to handle SQLITE_BUSY
-    rc = sqlite3_busy_timeout(db, BUSY_TIMEOUT_MS);
-    if(rc != SQLITE_OK)
+    // Close the handle and undo the VFS registrations: close() and the destructor see a database never opened
+    auto fail = [&](const string& msg)
     {
-        string msg = "Error setting busy timeout: ";
-        msg += sqlite3_errmsg(db);
+        runtime_error ret(msg + sqlite3_errmsg(db));
         sqlite3_close(db);
-        throw runtime_error(msg);
+        db = nullptr;
+        if(io)
+        {
+            io_vfs::detach(file_db_path);
+            io = nullptr;
+        }
+        if(!options.encryption_key.empty())
+        {
+            crypto_vfs::remove_key(file_db_path);
+        }
+        vfs_name.clear();
+        throw ret;
+    };
+
+    int rc = sqlite3_open_v2(file_db_path.c_str(), &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX, vfs);
+    if(rc != SQLITE_OK)
+    {
+        fail("Error opening database: ");
+    }
+
+    // An encrypted file opened with a wrong key, or without one, is not a database: fail here,
+    // before is_created() takes it for a new one and create() removes it
+    if(rc = sqlite3_exec(db, "SELECT count(*) FROM sqlite_schema", nullptr, nullptr, nullptr); rc == SQLITE_NOTADB)
+    {
+        fail("Error opening database: ");
+    }
+
+    // Jittered backoff up to busy_timeout_ms, or to the deadline of the call, to handle SQLITE_BUSY
+    busy.set_timeout(chrono::milliseconds(options.busy_timeout_ms));
+    busy.install(db);
+    create_functions(db);
+
+    // page_size must precede the creation of the first table
+    if(auto&& pragmas = options.pragmas(true); !pragmas.empty())
+    {
+        if(rc = sqlite3_exec(db, pragmas.c_str(), nullptr, nullptr, nullptr); rc != SQLITE_OK)
+        {
+            fail("Error setting open options: ");
+        }
     }
 
     database::file_db_path = file_db_path;
+    database::options = options;
+    database::mode = options.mode;
+    if(profiling)
+    {
+        profiler.attach(db);
+    }
 
     uint8_t version = 0;
     if(is_created(version)) //throw exception
@@ -110,14 +283,26 @@ bool database::open(const string& file_db_path)
         {
             case 1:
                 error(typeid(*this).name(), "Db version not supported, delete and resynch");
-                [[fallthrough]];
+                break;
             default:
-                [[likely]] case 2:
+                if(version > VERSION)
+                {
+                    error(typeid(*this).name(), "Db version " + to_string(version) + " newer than " + to_string(VERSION));
+                }
                 break;
         }
         
         // Set WAL mode after database is confirmed to exist and be accessible
-        set_wal_mode();
+        if(options.wal)
+        {
+            set_wal_mode();
+        }
+        if(version >= CREATION_VERSION)
+        {
+            migrator(*this).migrate(); //throw exception
+            load_ciphertext_storage();
+        }
+        open_read_pool();
     }
     else
     {
@@ -127,7 +312,13 @@ bool database::open(const string& file_db_path)
             if(result)
             {
                 // Set WAL mode after successful database creation
-                set_wal_mode();
+                if(options.wal)
+                {
+                    set_wal_mode();
+                }
+                migrator(*this).migrate(); //throw exception
+                load_ciphertext_storage();
+                open_read_pool();
             }
             return result;
         }
@@ -144,13 +335,19 @@ bool database::open(const string& file_db_path)
 
 inline void database::close()
 {
+    stop_executor();
+    stop_maintenance();
+
     if(db == nullptr)
     {
         return;
     }
 
     unlock();
-    
+
+    reads.close();
+    statements.clear();
+
     // Force finalize all prepared statements
     sqlite3_stmt* stmt = nullptr;
     while((stmt = sqlite3_next_stmt(db, nullptr)) != nullptr)
@@ -173,16 +370,21 @@ inline void database::close()
     }
     db = nullptr;
 
+    if(io)
+    {
+        // The report stays readable, files opened from now on are not counted
+        io_vfs::detach(file_db_path);
+    }
+
 }
 
 bool database::is_created(uint8_t& db_version) noexcept try
 {
-    lock();
+    write_guard guard(*this);
 
     result_set rs(*this, "SELECT * FROM metadata"); //throw exception
     if(rs.get_statement_stat() != SQLITE_OK)
     {
-        unlock();
         return false;
     }
 
@@ -191,15 +393,12 @@ bool database::is_created(uint8_t& db_version) noexcept try
         db_version = it->begin()->second.to_integer();
     }
 
-    unlock();
     return true;
 }
 catch (...)
 {
     cerr << "Unhandled exception is_created()" << endl;
 
-    unlock();
-
     auto e_ptr = current_exception();
 
     if (e_ptr)
@@ -229,7 +428,7 @@ bool database::create(const char creation_sql[])
     stringstream ss(creation_sql);
     string part;
 
-    lock();
+    write_guard guard(*this);
 
     uint8_t i = 0;
     bool error = false;
@@ -243,7 +442,7 @@ bool database::create(const char creation_sql[])
         try
         {
 
-            result_set rs(*this, part, {variant{VERSION}}); //throw exception
+            result_set rs(*this, part, {variant{CREATION_VERSION}}); //throw exception
             if(rs.get_statement_stat() != SQLITE_OK)
             {
                 error = true;
@@ -254,7 +453,6 @@ bool database::create(const char creation_sql[])
         {
             close(); //throw exception
             rm(); //throw exception
-            unlock();
             throw runtime_error("Impossible execute query:" + part + " at row:" + to_string(i) + " error:" + e.what());
         }
 
@@ -264,7 +462,6 @@ bool database::create(const char creation_sql[])
     {
         close(); //throw exception
         rm(); //throw exception
-        unlock();
         throw runtime_error("Impossible execute query:" + part + " at row:" + to_string(i));
     }
 
@@ -272,7 +469,6 @@ bool database::create(const char creation_sql[])
 
     info(typeid(*this).name(), "Create database:" + file_db_path);
 
-    unlock();
     return true;
 }
 
@@ -293,7 +489,11 @@ bool database::rm()
 
 void database::lock()
 {
-#ifndef POCKET_DISABLE_DB_LOCK
+    if(mode != lock_mode::PRAGMA_EXCLUSIVE)
+    {
+        return;
+    }
+
     if(transaction_active) 
     {
         debug(typeid(*this).name(), "Transaction already active, skipping lock");
@@ -314,12 +514,15 @@ void database::lock()
         throw runtime_error(msg);
     }
     transaction_active = true;
-#endif
 }
 
 void database::unlock()
 {
-#ifndef POCKET_DISABLE_DB_LOCK
+    if(mode != lock_mode::PRAGMA_EXCLUSIVE)
+    {
+        return;
+    }
+
     if(!transaction_active) 
     {
         debug(typeid(*this).name(), "No active transaction, skipping unlock");
@@ -341,137 +544,891 @@ void database::unlock()
         throw runtime_error(msg);
     }
     transaction_active = false;
-#endif
 }
 
-void database::set_wal_mode() noexcept
+database::write_guard::write_guard(database& db)
+: db(db)
 {
-    // Attempt to set WAL mode with retry mechanism
-    for(int attempt = 0; attempt < 3; ++attempt)
+    if(db.mode == lock_mode::WRITER_MUTEX)
     {
-        char* err = nullptr;
-        int rc = sqlite3_exec(db, "PRAGMA journal_mode=WAL;", nullptr, nullptr, &err);
-        
-        if(rc == SQLITE_OK)
-        {
-            info(typeid(*this).name(), "Successfully set WAL mode");
-            return;
-        }
-        
-        string error_msg;
-        if(err)
-        {
-            error_msg = err;
-            sqlite3_free(err);
-        }
-        else
-        {
-            error_msg = sqlite3_errmsg(db);
-        }
-        
-        if(rc == SQLITE_BUSY && attempt < 2)
-        {
-            info(typeid(*this).name(), "Database busy when setting WAL mode, retrying... (attempt " + to_string(attempt + 1) + "/3)");
-            this_thread::sleep_for(chrono::milliseconds(100 * (attempt + 1)));
-            continue;
-        }
-        
-        // If we get here, either it's not SQLITE_BUSY or we've exhausted retries
-        info(typeid(*this).name(), "Failed to set WAL mode: " + error_msg + 
-                " (continuing with default journal mode)");
+        db.writer.lock();
+    }
+    else
+    {
+        db.lock();
+    }
+}
+
+database::write_guard::~write_guard()
+{
+    if(db.mode == lock_mode::WRITER_MUTEX)
+    {
+        db.writer.unlock();
         return;
     }
+
+    try
+    {
+        db.unlock();
+    }
+    catch (const exception& e)
+    {
+        error(typeid(*this).name(), e.what());
+    }
 }
 
-optional<result_set::ptr> database::execute(const string&& query, const parameters& parameters) try
+void database::set_profiling(bool enable) noexcept
 {
-    return execute_with_retry([&]() -> optional<result_set::ptr> {
-        lock();
-        auto rs = make_unique<result_set>(*this, query, parameters);
+    profiling = enable;
+    if(enable)
+    {
+        profiler.attach(db);
+    }
+    else
+    {
+        statement_profiler::detach(db);
+    }
+    reads.set_profiler(enable ? &profiler : nullptr);
+}
 
-        if(rs->get_statement_stat() != SQLITE_OK)
+bool database::checkpoint(checkpoint_mode mode, int* log, int* checkpointed)
+{
+    if(db == nullptr)
+    {
+        throw runtime_error("Database not open");
+    }
+
+    // Only the blocking modes wait for the writers of this process
+    optional<write_guard> guard;
+    if(mode != checkpoint_mode::PASSIVE)
+    {
+        guard.emplace(*this);
+    }
+
+    int rc = sqlite3_wal_checkpoint_v2(db, nullptr, static_cast<int>(mode), log, checkpointed);
+    if(rc == SQLITE_BUSY)
+    {
+        debug(typeid(*this).name(), "Checkpoint busy");
+        return false;
+    }
+    else if(rc != SQLITE_OK)
+    {
+        throw runtime_error("Checkpoint error:" + string(sqlite3_errmsg(db)));
+    }
+    return true;
+}
+
+int64_t database::incremental_vacuum(uint32_t pages)
+{
+    write_guard guard(*this);
+    auto before = get_freelist_count();
+    exec("PRAGMA incremental_vacuum(" + to_string(pages) + ")");
+    return before - get_freelist_count();
+}
+
+int64_t database::get_freelist_count()
+{
+    static const string query = "PRAGMA freelist_count";
+
+    int64_t ret = 0;
+    auto read = [&ret](const cursor& cursor)
+    {
+        ret = cursor.get_integer(0);
+        return false;
+    };
+    return execute_with_retry([&]() -> int64_t {
+        // Polled by maintenance: on a read connection it does not wait for the writer
+        if(reads.get_max_size() > 0 && !owns_transaction())
         {
-            unlock();
-            if(rs->get_statement_stat() == SQLITE_BUSY)
-            {
-                throw runtime_error("SQLITE_BUSY: Database is locked");
-            }
-            return nullopt;
+            auto&& connection = reads.acquire();
+            step(connection->db, connection->statements, query, {}, read);
+            return ret;
         }
 
-        unlock();
-        return rs;
+        write_guard guard(*this);
+        step(db, statements, query, {}, read);
+        return ret;
     });
 }
-catch (...)
+
+uint64_t database::get_wal_size() const noexcept
 {
-    unlock();
-    throw;
+    error_code ec;
+    auto ret = file_size(file_db_path + "-wal", ec);
+    return ec ? 0 : ret;
 }
 
+namespace
+{
 
-int64_t database::update(const string&& query, const parameters& parameters) try
+// pocket_base64_decode(text) and pocket_base64_encode(blob), used to convert the ciphertext columns
+void base64_function(sqlite3_context* ctx, int, sqlite3_value** argv) noexcept try
 {
-    return execute_with_retry([&]() -> int64_t {
-        lock();
-        auto rs = make_unique<result_set>(*this, query, parameters);
+    const bool decode = sqlite3_user_data(ctx) != nullptr;
+    if(sqlite3_value_type(argv[0]) == SQLITE_NULL)
+    {
+        sqlite3_result_null(ctx);
+        return;
+    }
 
-        if(rs->get_statement_stat() != SQLITE_OK)
-        {
-            unlock();
-            if(rs->get_statement_stat() == SQLITE_BUSY)
-            {
-                throw runtime_error("SQLITE_BUSY: Database is locked");
-            }
-            return -1;
-        }
+    auto data = static_cast<const uint8_t*>(sqlite3_value_blob(argv[0]));
+    auto size = static_cast<size_t>(sqlite3_value_bytes(argv[0]));
+    if(size == 0)
+    {
+        decode ? sqlite3_result_zeroblob(ctx, 0) : sqlite3_result_text(ctx, "", 0, SQLITE_STATIC);
+        return;
+    }
 
-        unlock();
-        return rs->get_total_changes();
-    });
+    if(decode)
+    {
+        auto&& bytes = crypto_base64_decode(string(reinterpret_cast<const char*>(data), size), false);
+        sqlite3_result_blob64(ctx, bytes.data(), bytes.size(), SQLITE_TRANSIENT);
+    }
+    else
+    {
+        auto&& text = crypto_base64_encode(data, size, false);
+        sqlite3_result_text64(ctx, text.data(), text.size(), SQLITE_TRANSIENT, SQLITE_UTF8);
+    }
 }
-catch (...)
+catch (const exception& e)
 {
-    unlock();
-    throw;
+    sqlite3_result_error(ctx, e.what(), -1);
 }
 
-// Template implementation for retry logic
-template<typename Func>
-auto database::execute_with_retry(Func&& func, uint8_t max_retries) -> decltype(func())
+constexpr char CIPHERTEXT_COLUMNS_SQL[] = R"(
+UPDATE groups SET title = %1$s(title), icon = %1$s(icon), _note = %1$s(_note);
+UPDATE group_fields SET title = %1$s(title);
+UPDATE fields SET title = %1$s(title), value = %1$s(value);
+UPDATE metadata SET ciphertext_storage = %2$d;
+)";
+
+}
+
+void database::set_ciphertext_storage(ciphertext_storage storage)
 {
-    for(uint8_t attempt = 0; attempt < max_retries; ++attempt)
+    if(db == nullptr)
     {
-        try
-        {
-            return func();
-        }
-        catch(const runtime_error& e)
-        {
-            // Check if it's a SQLITE_BUSY error
-            string error_msg = e.what();
-            if(error_msg.find("SQLITE_BUSY") != std::string::npos || 
-               error_msg.find("database is locked") != std::string::npos)
-            {
-                if(attempt < max_retries - 1)
-                {
-                    // Wait before retry with exponential backoff
-                    auto wait_time = std::chrono::milliseconds(100 * (1 << attempt));
-                    this_thread::sleep_for(wait_time);
-                    
-                    debug(typeid(*this).name(), 
-                          "SQLITE_BUSY detected, retrying attempt " + 
-                          to_string(attempt + 2) + "/" + 
-                          to_string(max_retries));
-                    continue;
-                }
-            }
-            // Re-throw if not SQLITE_BUSY or max retries reached
-            throw;
+        throw runtime_error("Database not open");
+    }
+    if(storage == this->storage)
+    {
+        return;
+    }
+
+    int rc = sqlite3_create_function_v2(db, "pocket_base64_decode", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, reinterpret_cast<void*>(1), base64_function, nullptr, nullptr, nullptr);
+    if(rc == SQLITE_OK)
+    {
+        rc = sqlite3_create_function_v2(db, "pocket_base64_encode", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr, base64_function, nullptr, nullptr, nullptr);
+    }
+    if(rc != SQLITE_OK)
+    {
+        throw runtime_error("Error registering base64 functions: " + string(sqlite3_errmsg(db)));
+    }
+
+    char sql[sizeof(CIPHERTEXT_COLUMNS_SQL) + 128];
+    snprintf(sql, sizeof(sql), CIPHERTEXT_COLUMNS_SQL, storage == ciphertext_storage::RAW ? "pocket_base64_decode" : "pocket_base64_encode", static_cast<int>(storage));
+
+    transaction transaction(*this);
+    exec(sql); //throw exception
+    transaction.commit();
+
+    this->storage = storage;
+    info(typeid(*this).name(), string("Ciphertext storage: ") + (storage == ciphertext_storage::RAW ? "raw" : "base64"));
+}
+
+namespace
+{
+
+// pocket_decrypt(column): user data is the database, its cipher is read on every call as it may change
+void decrypt_function(sqlite3_context* ctx, int, sqlite3_value** argv) noexcept try
+{
+    auto type = sqlite3_value_type(argv[0]);
+    auto cipher = static_cast<const database*>(sqlite3_user_data(ctx))->get_cipher();
+    if(type == SQLITE_NULL || cipher == nullptr || sqlite3_value_bytes(argv[0]) == 0)
+    {
+        sqlite3_result_value(ctx, argv[0]);
+        return;
+    }
+
+    // BLOB with raw ciphertext storage, base64 TEXT otherwise
+    auto data = type == SQLITE_BLOB ? sqlite3_value_blob(argv[0]) : sqlite3_value_text(argv[0]);
+    auto&& plain = cipher->decrypt(string_view(static_cast<const char*>(data), sqlite3_value_bytes(argv[0])));
+    sqlite3_result_text64(ctx, plain.data(), plain.size(), SQLITE_TRANSIENT, SQLITE_UTF8);
+}
+catch (const exception& e)
+{
+    sqlite3_result_error(ctx, e.what(), -1);
+}
+
+// pocket_fold(text): lower case as the search in the views, ASCII only
+void fold_function(sqlite3_context* ctx, int, sqlite3_value** argv) noexcept try
+{
+    if(sqlite3_value_type(argv[0]) == SQLITE_NULL)
+    {
+        sqlite3_result_null(ctx);
+        return;
+    }
+
+    auto text = reinterpret_cast<const char*>(sqlite3_value_text(argv[0]));
+    string ret(text ? text : "", sqlite3_value_bytes(argv[0]));
+    transform(ret.cbegin(), ret.cend(), ret.begin(), [](unsigned char c){ return static_cast<char>(tolower(c)); });
+    sqlite3_result_text64(ctx, ret.data(), ret.size(), SQLITE_TRANSIENT, SQLITE_UTF8);
+}
+catch (const exception& e)
+{
+    sqlite3_result_error(ctx, e.what(), -1);
+}
+
+}
+
+void database::create_functions(sqlite3* handle) noexcept
+{
+    // Not callable from triggers or views in the schema: the plaintext never leaves the statements of this process
+    int rc = sqlite3_create_function_v2(handle, "pocket_decrypt", 1, SQLITE_UTF8 | SQLITE_DIRECTONLY, this, decrypt_function, nullptr, nullptr, nullptr);
+    if(rc == SQLITE_OK)
+    {
+        rc = sqlite3_create_function_v2(handle, "pocket_fold", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC | SQLITE_INNOCUOUS, nullptr, fold_function, nullptr, nullptr, nullptr);
+    }
+    if(rc != SQLITE_OK)
+    {
+        error(typeid(*this).name(), "Error registering SQL functions: " + string(sqlite3_errmsg(handle)));
+    }
+}
+
+void database::set_cipher(shared_ptr<const aes> cipher) noexcept
+{
+    lock_guard<mutex> lg(cipher_m);
+    this->cipher = std::move(cipher);
+}
+
+shared_ptr<const aes> database::get_cipher() const noexcept
+{
+    lock_guard<mutex> lg(cipher_m);
+    return cipher;
+}
+
+void database::load_ciphertext_storage() noexcept try
+{
+    auto&& rs = execute("SELECT ciphertext_storage FROM metadata");
+    storage = rs && !rs.value()->empty() && rs.value()->at(0).at(0).to_integer() == static_cast<int>(ciphertext_storage::RAW)
+        ? ciphertext_storage::RAW : ciphertext_storage::BASE64;
+}
+catch (const runtime_error& e)
+{
+    error(typeid(*this).name(), e.what());
+    storage = ciphertext_storage::BASE64;
+}
+
+bool database::snapshot_to(const string& file_path, int pages_per_step, const snapshot_progress& progress)
+{
+    if(db == nullptr)
+    {
+        throw runtime_error("Database not open");
+    }
+
+    auto tmp_path = file_path + ".tmp";
+    std::filesystem::remove(tmp_path);
+
+    sqlite3* dest = nullptr;
+    if(!options.encryption_key.empty())
+    {
+        // Pages are encrypted again on their way to the copy, with the key of this database
+        crypto_vfs::set_key(tmp_path, options.encryption_key);
+        crypto_vfs::set_key(file_path, options.encryption_key);
+    }
+
+    if(int rc = sqlite3_open_v2(tmp_path.c_str(), &dest, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, get_vfs()); rc != SQLITE_OK)
+    {
+        string msg = "Error opening snapshot: ";
+        msg += sqlite3_errmsg(dest);
+        sqlite3_close(dest);
+        throw runtime_error(msg);
+    }
+
+    // The writer connection is the source: its own commits are applied to the copy without restarting it
+    auto backup = sqlite3_backup_init(dest, "main", db, "main");
+    if(backup == nullptr)
+    {
+        string msg = "Error starting snapshot: ";
+        msg += sqlite3_errmsg(dest);
+        sqlite3_close(dest);
+        std::filesystem::remove(tmp_path);
+        throw runtime_error(msg);
+    }
+
+    int rc = SQLITE_OK;
+    do
+    {
+        {
+            // A step never sees the pages of a transaction still open on the writer
+            write_guard guard(*this);
+            rc = sqlite3_backup_step(backup, pages_per_step);
+        }
+
+        if(progress)
+        {
+            progress(sqlite3_backup_remaining(backup), sqlite3_backup_pagecount(backup));
+        }
+
+        if(rc == SQLITE_BUSY || rc == SQLITE_LOCKED)
+        {
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+        else if(rc == SQLITE_OK)
+        {
+            this_thread::yield();
+        }
+    }
+    while(rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED);
+
+    sqlite3_backup_finish(backup);
+    if(rc != SQLITE_DONE)
+    {
+        string msg = "Snapshot error: ";
+        msg += sqlite3_errstr(rc);
+        sqlite3_close(dest);
+        std::filesystem::remove(tmp_path);
+        throw runtime_error(msg);
+    }
+    sqlite3_close(dest);
+
+    std::filesystem::rename(tmp_path, file_path);
+    crypto_vfs::remove_key(tmp_path);
+    info(typeid(*this).name(), "Snapshot to:" + file_path);
+    return true;
+}
+
+bool database::restore_from(const string& file_path, int pages_per_step, const snapshot_progress& progress)
+{
+    if(db == nullptr)
+    {
+        throw runtime_error("Database not open");
+    }
+
+    if(!exists(file_path))
+    {
+        throw runtime_error("Snapshot not found: " + file_path);
+    }
+
+    if(!options.encryption_key.empty())
+    {
+        // Snapshots of an encrypted database share its key
+        crypto_vfs::set_key(file_path, options.encryption_key);
+    }
+
+    sqlite3* source = nullptr;
+    if(int rc = sqlite3_open_v2(file_path.c_str(), &source, SQLITE_OPEN_READONLY, get_vfs()); rc != SQLITE_OK)
+    {
+        string msg = "Error opening snapshot: ";
+        msg += sqlite3_errmsg(source);
+        sqlite3_close(source);
+        throw runtime_error(msg);
+    }
+
+    int rc = SQLITE_OK;
+    {
+        write_guard guard(*this);
+
+        auto backup = sqlite3_backup_init(db, "main", source, "main");
+        if(backup == nullptr)
+        {
+            string msg = "Error starting restore: ";
+            msg += sqlite3_errmsg(db);
+            sqlite3_close(source);
+            throw runtime_error(msg);
+        }
+
+        do
+        {
+            rc = sqlite3_backup_step(backup, pages_per_step);
+            if(progress)
+            {
+                progress(sqlite3_backup_remaining(backup), sqlite3_backup_pagecount(backup));
+            }
+            if(rc == SQLITE_BUSY || rc == SQLITE_LOCKED)
+            {
+                this_thread::sleep_for(chrono::milliseconds(10));
+            }
+        }
+        while(rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED);
+
+        sqlite3_backup_finish(backup);
+    }
+    sqlite3_close(source);
+
+    if(rc != SQLITE_DONE)
+    {
+        throw runtime_error("Restore error: " + string(sqlite3_errstr(rc)));
+    }
+
+    statements.clear();
+    migrator(*this).migrate(); //throw exception
+    load_ciphertext_storage();
+
+    info(typeid(*this).name(), "Restore from:" + file_path);
+    return true;
+}
+
+void database::start_maintenance(const maintenance::options& options)
+{
+    if(db == nullptr)
+    {
+        throw runtime_error("Database not open");
+    }
+
+    if(housekeeping)
+    {
+        return;
+    }
+    housekeeping = make_unique<maintenance>(*this, db, options);
+}
+
+void database::stop_maintenance() noexcept
+{
+    if(housekeeping)
+    {
+        housekeeping->stop();
+        housekeeping = nullptr;
+    }
+}
+
+void database::start_executor(chrono::microseconds window, size_t max_batch)
+{
+    if(db == nullptr)
+    {
+        throw runtime_error("Database not open");
+    }
+
+    unique_lock lock(executor_m);
+    if(executor)
+    {
+        return;
+    }
+    executor = make_unique<write_executor>(*this, window, max_batch);
+}
+
+void database::stop_executor()
+{
+    {
+        // Shared: a job still running may call submit(), that throws once stopping
+        shared_lock lock(executor_m);
+        if(executor == nullptr)
+        {
+            return;
+        }
+        executor->stop();
+    }
+
+    // Once the submit() calls that still see the executor are done
+    unique_lock lock(executor_m);
+    executor = nullptr;
+}
+
+void database::set_wal_mode() noexcept
+{
+    // Attempt to set WAL mode with retry mechanism
+    for(int attempt = 0; attempt < 3; ++attempt)
+    {
+        char* err = nullptr;
+        int rc = sqlite3_exec(db, "PRAGMA journal_mode=WAL;", nullptr, nullptr, &err);
+        
+        if(rc == SQLITE_OK)
+        {
+            info(typeid(*this).name(), "Successfully set WAL mode");
+            return;
+        }
+        
+        string error_msg;
+        if(err)
+        {
+            error_msg = err;
+            sqlite3_free(err);
+        }
+        else
+        {
+            error_msg = sqlite3_errmsg(db);
+        }
+        
+        if(rc == SQLITE_BUSY && attempt < 2)
+        {
+            info(typeid(*this).name(), "Database busy when setting WAL mode, retrying... (attempt " + to_string(attempt + 1) + "/3)");
+            this_thread::sleep_for(chrono::milliseconds(100 * (attempt + 1)));
+            continue;
+        }
+        
+        // If we get here, either it's not SQLITE_BUSY or we've exhausted retries
+        info(typeid(*this).name(), "Failed to set WAL mode: " + error_msg + 
+                " (continuing with default journal mode)");
+        return;
+    }
+}
+
+void database::open_read_pool() noexcept
+{
+    if(mode == lock_mode::PRAGMA_EXCLUSIVE)
+    {
+        // PRAGMA locking_mode = EXCLUSIVE keeps the file locked for any other connection
+        debug(typeid(*this).name(), "Read pool disabled by database lock");
+        return;
+    }
+
+    if(file_db_path.empty() || file_db_path == ":memory:")
+    {
+        return;
+    }
+    if(options.read_pool_size == 0 || !options.wal)
+    {
+        // Without WAL readers and the writer block each other
+        return;
+    }
+    reads.open(file_db_path, options.read_pool_size, &busy, options.pragmas(false), get_vfs(), [this](sqlite3* handle)
+    {
+        create_functions(handle);
+    });
+}
+
+void database::exec(const string& query)
+{
+    char* err = nullptr;
+    if(int rc = sqlite3_exec(db, query.c_str(), nullptr, nullptr, &err); rc != SQLITE_OK)
+    {
+        string msg = "Impossible execute query:" + query;
+        if(err)
+        {
+            msg += " error:";
+            msg += err;
+            sqlite3_free(err);
+        }
+        throw runtime_error(msg);
+    }
+}
+
+database::transaction::transaction(database& db)
+: db(db)
+{
+    if(db.db == nullptr)
+    {
+        throw runtime_error("Database not open");
+    }
+
+    // Other threads of this process wait here until the outermost transaction ends
+    if(db.mode == lock_mode::WRITER_MUTEX)
+    {
+        db.writer.lock();
+    }
+
+    try
+    {
+        if(db.transaction_depth == 0)
+        {
+            db.exec("BEGIN IMMEDIATE");
+            db.transaction_owner = this_thread::get_id();
+        }
+        else
+        {
+            savepoint = "sp_" + to_string(db.transaction_depth);
+            db.exec("SAVEPOINT " + savepoint);
+        }
+    }
+    catch (...)
+    {
+        release();
+        throw;
+    }
+    db.transaction_depth++;
+}
+
+database::transaction::~transaction()
+{
+    if(done)
+    {
+        return;
+    }
+
+    try
+    {
+        rollback();
+    }
+    catch (const exception& e)
+    {
+        error(typeid(*this).name(), e.what());
+    }
+}
+
+void database::transaction::commit()
+{
+    if(done)
+    {
+        return;
+    }
+
+    try
+    {
+        if(savepoint.empty())
+        {
+            db.exec("COMMIT");
+        }
+        else
+        {
+            db.exec("RELEASE " + savepoint);
+        }
+    }
+    catch (...)
+    {
+        // SQLITE_BUSY, a deferred foreign key or an I/O error leave the transaction open:
+        // roll it back, or every later statement of the connection would run inside it
+        try
+        {
+            undo();
+        }
+        catch (const exception& e)
+        {
+            error(typeid(*this).name(), e.what());
+        }
+        end();
+        throw;
+    }
+    end();
+}
+
+void database::transaction::rollback()
+{
+    if(done)
+    {
+        return;
+    }
+
+    try
+    {
+        undo();
+    }
+    catch (...)
+    {
+        end();
+        throw;
+    }
+    end();
+}
+
+void database::transaction::undo()
+{
+    if(savepoint.empty())
+    {
+        // SQLite may have rolled back already, on SQLITE_FULL or SQLITE_IOERR for instance
+        if(!sqlite3_get_autocommit(db.db))
+        {
+            db.exec("ROLLBACK");
+        }
+    }
+    else
+    {
+        db.exec("ROLLBACK TO " + savepoint);
+        db.exec("RELEASE " + savepoint);
+    }
+}
+
+void database::transaction::end() noexcept
+{
+    done = true;
+    if(--db.transaction_depth == 0)
+    {
+        db.transaction_owner = thread::id();
+    }
+    release();
+}
+
+void database::transaction::release() noexcept
+{
+    if(db.mode == lock_mode::WRITER_MUTEX)
+    {
+        db.writer.unlock();
+    }
+}
+
+optional<result_set::ptr> database::execute(const string& query, const parameters& parameters)
+{
+    return execute_with_retry([&]() -> optional<result_set::ptr> {
+        // Reads of the thread that owns the write transaction must see its uncommitted rows
+        if(reads.get_max_size() > 0 && is_read_query(query) && !owns_transaction())
+        {
+            auto&& connection = reads.acquire();
+            auto rs = make_unique<result_set>(*this, *connection, query, parameters);
+            if(rs->get_statement_stat() != SQLITE_OK)
+            {
+                if(rs->get_statement_stat() == SQLITE_BUSY)
+                {
+                    throw database_error("SQLITE_BUSY: Database is locked", rs->get_extended_stat());
+                }
+                return nullopt;
+            }
+            return rs;
+        }
+
+        write_guard guard(*this);
+        auto rs = make_unique<result_set>(*this, query, parameters);
+
+        if(rs->get_statement_stat() != SQLITE_OK)
+        {
+            if(rs->get_statement_stat() == SQLITE_BUSY)
+            {
+                throw database_error("SQLITE_BUSY: Database is locked", rs->get_extended_stat());
+            }
+            return nullopt;
+        }
+
+        return rs;
+    });
+}
+
+
+int64_t database::update(const string& query, const parameters& parameters)
+{
+    return execute_with_retry([&]() -> int64_t {
+        write_guard guard(*this);
+        auto rs = make_unique<result_set>(*this, query, parameters);
+
+        if(rs->get_statement_stat() != SQLITE_OK)
+        {
+            if(rs->get_statement_stat() == SQLITE_BUSY)
+            {
+                throw database_error("SQLITE_BUSY: Database is locked", rs->get_extended_stat());
+            }
+            return -1;
+        }
+
+        return rs->get_total_changes();
+    });
+}
+
+int64_t database::query(const string& query, const parameters& parameters, const visitor& visitor)
+{
+    return execute_with_retry([&]() -> int64_t {
+        if(reads.get_max_size() > 0 && is_read_query(query) && !owns_transaction())
+        {
+            auto&& connection = reads.acquire();
+            return step(connection->db, connection->statements, query, parameters, visitor);
+        }
+
+        write_guard guard(*this);
+        return step(db, statements, query, parameters, visitor);
+    });
+}
+
+void database::bind(sqlite3_stmt* stmt, const parameters& parameters) noexcept
+{
+    for(int i = 1; auto &&param : parameters) {
+        switch (param.get_type()) {
+            default:
+            case TEXT:
+            {
+                // parameters outlive the stepping and the cache clears the bindings on release, no copy needed
+                auto text = param.to_text_view();
+                sqlite3_bind_text64(stmt, i, text.data() ? text.data() : "", text.size(), SQLITE_STATIC, SQLITE_UTF8);
+#ifdef POCKET_ENABLE_LOG
+                debug(typeid(database).name(), to_string(i) + ": " + string(text));
+#endif
+                break;
+            }
+            case BLOB:
+            {
+                auto bytes = param.to_text_view();
+                sqlite3_bind_blob64(stmt, i, bytes.data() ? bytes.data() : "", bytes.size(), SQLITE_STATIC);
+                break;
+            }
+            case INT:
+                sqlite3_bind_int(stmt, i, static_cast<int32_t>(param.to_integer()));
+                debug(typeid(database).name(), to_string(i) + ": " + param.to_text());
+                break;
+            case INT64:
+                sqlite3_bind_int64(stmt, i, param.to_integer());
+                debug(typeid(database).name(), to_string(i) + ": " + param.to_text());
+                break;
+            case DOUBLE:
+                sqlite3_bind_double(stmt, i, param.to_float());
+                debug(typeid(database).name(), to_string(i) + ": " + param.to_text());
+                break;
+        }
+        i++;
+    }
+}
+
+int64_t database::step(sqlite3* handle, statement_cache& cache, const string& query, const parameters& parameters, const visitor& visitor)
+{
+    debug(typeid(*this).name(), query);
+
+    int rc = SQLITE_OK;
+    auto stmt = cache.acquire(handle, query, rc);
+    if(rc != SQLITE_OK)
+    {
+        string msg = "Impossible execute query err:" + string(sqlite3_errmsg(handle));
+        auto code = sqlite3_extended_errcode(handle);
+        sqlite3_finalize(stmt);
+        throw database_error(msg, code);
+    }
+
+    // Give back the statement also when the visitor throws
+    struct guard
+    {
+        statement_cache& cache;
+        const string& query;
+        sqlite3_stmt* stmt;
+        ~guard()
+        {
+            cache.release(query, stmt);
+        }
+    } g{cache, query, stmt};
+
+    bind(stmt, parameters);
+
+    // Column names only after the first step: a statement with bound values may be prepared again there
+    // and the names taken before would be freed
+    rc = sqlite3_step(stmt);
+    cursor cursor(stmt);
+    int64_t rows = 0;
+    for(; rc == SQLITE_ROW; rc = sqlite3_step(stmt))
+    {
+        rows++;
+        if(!visitor(cursor))
+        {
+            return rows;
+        }
+    }
+
+    if(rc != SQLITE_DONE)
+    {
+        // Retried only when no row reached the visitor yet
+        auto code = rows == 0 ? sqlite3_extended_errcode(handle) : SQLITE_ERROR;
+        throw database_error("Impossible execute query err:" + string(sqlite3_errmsg(handle)), code);
+    }
+
+    return rows;
+}
+
+// The busy handler already waited up to the deadline for a plain SQLITE_BUSY. Only the busy codes it is
+// not called for, like SQLITE_BUSY_SNAPSHOT or SQLITE_LOCKED, are retried here with a short jittered backoff.
+template<typename Func>
+auto database::execute_with_retry(Func&& func, uint8_t max_retries) -> decltype(func())
+{
+    for(uint8_t attempt = 1; ; ++attempt)
+    {
+        try
+        {
+            return func();
+        }
+        catch(const database_error& e)
+        {
+            if(!e.is_busy() || e.get_code() == SQLITE_BUSY || attempt >= max_retries)
+            {
+                throw;
+            }
+
+            thread_local minstd_rand random{static_cast<uint_fast32_t>(hash<thread::id>{}(this_thread::get_id()))};
+            auto backoff = busy_handler::MIN_BACKOFF * (1 << attempt);
+            this_thread::sleep_for(chrono::microseconds(uniform_int_distribution<int64_t>(backoff.count() / 2, backoff.count())(random)));
+
+            debug(typeid(*this).name(), "Busy code " + to_string(e.get_code()) + ", retrying attempt " + to_string(attempt + 1) + "/" + to_string(max_retries));
         }
     }
-    // This should never be reached, but needed for template compilation
-    return func();
 }
 
 }
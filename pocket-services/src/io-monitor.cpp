@@ -0,0 +1,107 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#include "pocket-services/io-monitor.hpp"
+
+#include <bit>
+
+namespace pocket::services::inline v5
+{
+
+using namespace std;
+using namespace std::chrono;
+
+namespace
+{
+
+// Statements, and so their I/O, run on the calling thread
+thread_local string_view current_tag;
+
+}
+
+io_monitor::tag_scope::tag_scope(string_view tag) noexcept
+: previous(current_tag)
+{
+    current_tag = tag;
+}
+
+io_monitor::tag_scope::~tag_scope()
+{
+    current_tag = previous;
+}
+
+string_view io_monitor::get_tag() noexcept
+{
+    return current_tag.empty() ? UNTAGGED : current_tag;
+}
+
+const char* io_monitor::to_string(call c) noexcept
+{
+    switch(c)
+    {
+    case call::READ:
+        return "read";
+    case call::WRITE:
+        return "write";
+    case call::SYNC:
+        return "sync";
+    case call::TRUNCATE:
+        return "truncate";
+    default:
+        return "unknown";
+    }
+}
+
+void io_monitor::record(call c, uint64_t bytes, nanoseconds elapsed) noexcept try
+{
+    auto us = static_cast<uint64_t>(duration_cast<microseconds>(elapsed).count());
+    auto bucket = min<size_t>(bit_width(us), BUCKETS - 1);
+
+    lock_guard<mutex> lg(m);
+    auto tag = get_tag();
+    auto it = counters_by_tag.find(tag);
+    if(it == counters_by_tag.end())
+    {
+        it = counters_by_tag.emplace(string(tag), report::mapped_type{}).first;
+    }
+
+    auto&& counters = it->second[static_cast<size_t>(c)];
+    counters.calls++;
+    counters.bytes += bytes;
+    counters.time += elapsed;
+    counters.histogram[bucket]++;
+}
+catch (...)
+{
+    // Accounting never fails the I/O it measures
+}
+
+io_monitor::report io_monitor::get_report() const
+{
+    lock_guard<mutex> lg(m);
+    return counters_by_tag;
+}
+
+void io_monitor::reset() noexcept
+{
+    lock_guard<mutex> lg(m);
+    counters_by_tag.clear();
+}
+
+}
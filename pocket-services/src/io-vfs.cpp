@@ -0,0 +1,432 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+#include "pocket-services/io-vfs.hpp"
+
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <unordered_map>
+#include <sqlite3.h>
+
+namespace pocket::services::inline v5
+{
+
+using namespace std;
+using namespace std::chrono;
+using call = io_monitor::call;
+
+namespace
+{
+
+// Laid out as SQLite expects: the sqlite3_file first, the file of the parent VFS after the struct
+struct io_file final
+{
+    sqlite3_file base;
+    sqlite3_file* real;
+    shared_ptr<io_monitor>* monitor; // nullptr: not counted
+};
+
+// A registered VFS, never unregistered as connections may still use it
+struct instance final
+{
+    sqlite3_vfs vfs{};
+    string name;
+};
+
+mutex instances_m;
+unordered_map<string, unique_ptr<instance>> instances_by_parent;
+
+mutex monitors_m;
+unordered_map<string, shared_ptr<io_monitor>> monitors_by_path;
+
+inline sqlite3_vfs* parent_vfs(sqlite3_vfs* v) noexcept
+{
+    return static_cast<sqlite3_vfs*>(v->pAppData);
+}
+
+inline io_file* to_io_file(sqlite3_file* f) noexcept
+{
+    return reinterpret_cast<io_file*>(f);
+}
+
+string full_path(const string& path)
+{
+    auto root = sqlite3_vfs_find(nullptr);
+    if(root == nullptr)
+    {
+        return path;
+    }
+    string ret(root->mxPathname + 1, '\0');
+    // SQLITE_OK_SYMLINK is a success too
+    if((root->xFullPathname(root, path.c_str(), static_cast<int>(ret.size()), ret.data()) & 0xff) != SQLITE_OK)
+    {
+        return path;
+    }
+    ret.resize(strlen(ret.c_str()));
+    return ret;
+}
+
+shared_ptr<io_monitor> find_monitor(const char* file_db_path)
+{
+    if(file_db_path == nullptr)
+    {
+        return nullptr;
+    }
+    lock_guard<mutex> lg(monitors_m);
+    if(auto&& it = monitors_by_path.find(file_db_path); it != monitors_by_path.end())
+    {
+        return it->second;
+    }
+    return nullptr;
+}
+
+// Time f and record it on the monitor of the file, if any
+template<typename F>
+int timed(io_file* f, call c, uint64_t bytes, F&& io)
+{
+    if(f->monitor == nullptr)
+    {
+        return io();
+    }
+    auto start = steady_clock::now();
+    int rc = io();
+    (*f->monitor)->record(c, bytes, steady_clock::now() - start);
+    return rc;
+}
+
+int file_close(sqlite3_file* file)
+{
+    auto f = to_io_file(file);
+    int rc = f->real->pMethods->xClose(f->real);
+    delete f->monitor;
+    f->monitor = nullptr;
+    return rc;
+}
+
+int file_read(sqlite3_file* file, void* buf, int amt, sqlite3_int64 ofst)
+{
+    auto f = to_io_file(file);
+    return timed(f, call::READ, amt, [&] { return f->real->pMethods->xRead(f->real, buf, amt, ofst); });
+}
+
+int file_write(sqlite3_file* file, const void* buf, int amt, sqlite3_int64 ofst)
+{
+    auto f = to_io_file(file);
+    return timed(f, call::WRITE, amt, [&] { return f->real->pMethods->xWrite(f->real, buf, amt, ofst); });
+}
+
+int file_truncate(sqlite3_file* file, sqlite3_int64 size)
+{
+    auto f = to_io_file(file);
+    return timed(f, call::TRUNCATE, size, [&] { return f->real->pMethods->xTruncate(f->real, size); });
+}
+
+int file_sync(sqlite3_file* file, int flags)
+{
+    auto f = to_io_file(file);
+    return timed(f, call::SYNC, 0, [&] { return f->real->pMethods->xSync(f->real, flags); });
+}
+
+int file_size(sqlite3_file* file, sqlite3_int64* size)
+{
+    auto f = to_io_file(file);
+    return f->real->pMethods->xFileSize(f->real, size);
+}
+
+int file_lock(sqlite3_file* file, int lock)
+{
+    auto f = to_io_file(file);
+    return f->real->pMethods->xLock(f->real, lock);
+}
+
+int file_unlock(sqlite3_file* file, int lock)
+{
+    auto f = to_io_file(file);
+    return f->real->pMethods->xUnlock(f->real, lock);
+}
+
+int file_check_reserved_lock(sqlite3_file* file, int* out)
+{
+    auto f = to_io_file(file);
+    return f->real->pMethods->xCheckReservedLock(f->real, out);
+}
+
+int file_control(sqlite3_file* file, int op, void* arg)
+{
+    auto f = to_io_file(file);
+    return f->real->pMethods->xFileControl(f->real, op, arg);
+}
+
+int file_sector_size(sqlite3_file* file)
+{
+    auto f = to_io_file(file);
+    return f->real->pMethods->xSectorSize(f->real);
+}
+
+int file_device_characteristics(sqlite3_file* file)
+{
+    auto f = to_io_file(file);
+    return f->real->pMethods->xDeviceCharacteristics(f->real);
+}
+
+int file_shm_map(sqlite3_file* file, int page, int page_size, int extend, void volatile** out)
+{
+    auto f = to_io_file(file);
+    return f->real->pMethods->xShmMap(f->real, page, page_size, extend, out);
+}
+
+int file_shm_lock(sqlite3_file* file, int offset, int n, int flags)
+{
+    auto f = to_io_file(file);
+    return f->real->pMethods->xShmLock(f->real, offset, n, flags);
+}
+
+void file_shm_barrier(sqlite3_file* file)
+{
+    auto f = to_io_file(file);
+    f->real->pMethods->xShmBarrier(f->real);
+}
+
+int file_shm_unmap(sqlite3_file* file, int delete_flag)
+{
+    auto f = to_io_file(file);
+    return f->real->pMethods->xShmUnmap(f->real, delete_flag);
+}
+
+int file_fetch(sqlite3_file* file, sqlite3_int64 ofst, int amt, void** out)
+{
+    auto f = to_io_file(file);
+    if(f->real->pMethods->iVersion < 3)
+    {
+        *out = nullptr;
+        return SQLITE_OK;
+    }
+    return f->real->pMethods->xFetch(f->real, ofst, amt, out);
+}
+
+int file_unfetch(sqlite3_file* file, sqlite3_int64 ofst, void* p)
+{
+    auto f = to_io_file(file);
+    if(f->real->pMethods->iVersion < 3)
+    {
+        return SQLITE_OK;
+    }
+    return f->real->pMethods->xUnfetch(f->real, ofst, p);
+}
+
+const sqlite3_io_methods io_methods{
+    3,
+    file_close,
+    file_read,
+    file_write,
+    file_truncate,
+    file_sync,
+    file_size,
+    file_lock,
+    file_unlock,
+    file_check_reserved_lock,
+    file_control,
+    file_sector_size,
+    file_device_characteristics,
+    file_shm_map,
+    file_shm_lock,
+    file_shm_barrier,
+    file_shm_unmap,
+    file_fetch,
+    file_unfetch
+};
+
+int vfs_open(sqlite3_vfs* v, sqlite3_filename name, sqlite3_file* file, int flags, int* out_flags) try
+{
+    auto parent = parent_vfs(v);
+    auto f = to_io_file(file);
+    f->base.pMethods = nullptr;
+    f->real = reinterpret_cast<sqlite3_file*>(f + 1);
+    f->monitor = nullptr;
+
+    if(int rc = parent->xOpen(parent, name, f->real, flags, out_flags); rc != SQLITE_OK)
+    {
+        return rc;
+    }
+
+    shared_ptr<io_monitor> monitor;
+    if(flags & SQLITE_OPEN_MAIN_DB)
+    {
+        monitor = find_monitor(name);
+    }
+    else if(name && (flags & (SQLITE_OPEN_MAIN_JOURNAL | SQLITE_OPEN_WAL)))
+    {
+        monitor = find_monitor(sqlite3_filename_database(name));
+    }
+
+    if(monitor)
+    {
+        f->monitor = new shared_ptr<io_monitor>(std::move(monitor));
+    }
+    f->base.pMethods = &io_methods;
+    return SQLITE_OK;
+}
+catch (const bad_alloc&)
+{
+    auto f = to_io_file(file);
+    f->real->pMethods->xClose(f->real);
+    return SQLITE_NOMEM;
+}
+
+int vfs_delete(sqlite3_vfs* v, const char* name, int sync_dir)
+{
+    auto parent = parent_vfs(v);
+    return parent->xDelete(parent, name, sync_dir);
+}
+
+int vfs_access(sqlite3_vfs* v, const char* name, int flags, int* out)
+{
+    auto parent = parent_vfs(v);
+    return parent->xAccess(parent, name, flags, out);
+}
+
+int vfs_full_pathname(sqlite3_vfs* v, const char* name, int size, char* out)
+{
+    auto parent = parent_vfs(v);
+    return parent->xFullPathname(parent, name, size, out);
+}
+
+void* vfs_dl_open(sqlite3_vfs* v, const char* name)
+{
+    auto parent = parent_vfs(v);
+    return parent->xDlOpen(parent, name);
+}
+
+void vfs_dl_error(sqlite3_vfs* v, int size, char* out)
+{
+    auto parent = parent_vfs(v);
+    parent->xDlError(parent, size, out);
+}
+
+void (*vfs_dl_sym(sqlite3_vfs* v, void* handle, const char* symbol))(void)
+{
+    auto parent = parent_vfs(v);
+    return parent->xDlSym(parent, handle, symbol);
+}
+
+void vfs_dl_close(sqlite3_vfs* v, void* handle)
+{
+    auto parent = parent_vfs(v);
+    parent->xDlClose(parent, handle);
+}
+
+int vfs_randomness(sqlite3_vfs* v, int size, char* out)
+{
+    auto parent = parent_vfs(v);
+    return parent->xRandomness(parent, size, out);
+}
+
+int vfs_sleep(sqlite3_vfs* v, int microseconds)
+{
+    auto parent = parent_vfs(v);
+    return parent->xSleep(parent, microseconds);
+}
+
+int vfs_current_time(sqlite3_vfs* v, double* out)
+{
+    auto parent = parent_vfs(v);
+    return parent->xCurrentTime(parent, out);
+}
+
+int vfs_get_last_error(sqlite3_vfs* v, int size, char* out)
+{
+    auto parent = parent_vfs(v);
+    return parent->xGetLastError ? parent->xGetLastError(parent, size, out) : 0;
+}
+
+int vfs_current_time_int64(sqlite3_vfs* v, sqlite3_int64* out)
+{
+    auto parent = parent_vfs(v);
+    return parent->xCurrentTimeInt64(parent, out);
+}
+
+}
+
+const char* io_vfs::install(const char* parent_name)
+{
+    string key = parent_name ? parent_name : "";
+
+    lock_guard<mutex> lg(instances_m);
+    if(auto&& it = instances_by_parent.find(key); it != instances_by_parent.end())
+    {
+        return it->second->name.c_str();
+    }
+
+    auto parent = sqlite3_vfs_find(parent_name);
+    if(parent == nullptr || parent->iVersion < 2)
+    {
+        throw runtime_error("VFS not found: " + key);
+    }
+
+    auto ret = make_unique<instance>();
+    ret->name = key.empty() ? NAME : string(NAME) + "-" + key;
+
+    auto&& vfs = ret->vfs;
+    vfs.iVersion = 2;
+    vfs.szOsFile = static_cast<int>(sizeof(io_file)) + parent->szOsFile;
+    vfs.mxPathname = parent->mxPathname;
+    vfs.zName = ret->name.c_str();
+    vfs.pAppData = parent;
+    vfs.xOpen = vfs_open;
+    vfs.xDelete = vfs_delete;
+    vfs.xAccess = vfs_access;
+    vfs.xFullPathname = vfs_full_pathname;
+    vfs.xDlOpen = vfs_dl_open;
+    vfs.xDlError = vfs_dl_error;
+    vfs.xDlSym = vfs_dl_sym;
+    vfs.xDlClose = vfs_dl_close;
+    vfs.xRandomness = vfs_randomness;
+    vfs.xSleep = vfs_sleep;
+    vfs.xCurrentTime = vfs_current_time;
+    vfs.xGetLastError = vfs_get_last_error;
+    vfs.xCurrentTimeInt64 = vfs_current_time_int64;
+
+    if(int rc = sqlite3_vfs_register(&vfs, 0); rc != SQLITE_OK)
+    {
+        throw runtime_error("Impossible register VFS " + ret->name + ": " + sqlite3_errstr(rc));
+    }
+
+    return instances_by_parent.emplace(key, std::move(ret)).first->second->name.c_str();
+}
+
+void io_vfs::attach(const string& file_db_path, shared_ptr<io_monitor> monitor)
+{
+    auto path = full_path(file_db_path);
+    lock_guard<mutex> lg(monitors_m);
+    monitors_by_path[path] = std::move(monitor);
+}
+
+void io_vfs::detach(const string& file_db_path) noexcept try
+{
+    auto path = full_path(file_db_path);
+    lock_guard<mutex> lg(monitors_m);
+    monitors_by_path.erase(path);
+}
+catch (...)
+{
+}
+
+}
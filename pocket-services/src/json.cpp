@@ -18,6 +18,7 @@
  ***************************************************************************/
 
 #include "pocket-services/json.hpp"
+#include "pocket-services/crypto.hpp"
 #include "pocket/globals.hpp"
 
 namespace pocket::services::inline v5
@@ -33,9 +34,30 @@ using BS::thread_pool;
 namespace
 {
 constexpr char APP_TAG[] = "json";
+
+// Raw ciphertext bytes to the base64 sent on the wire
+inline string to_wire(const string& value, bool raw_ciphertext)
+{
+    if(!raw_ciphertext || value.empty())
+    {
+        return value;
+    }
+    return crypto_base64_encode(reinterpret_cast<const uint8_t*>(value.data()), value.size(), false);
+}
+
+inline string from_wire(const string& value, bool raw_ciphertext)
+{
+    if(!raw_ciphertext || value.empty())
+    {
+        return value;
+    }
+    auto&& bytes = crypto_base64_decode(value, false);
+    return {bytes.begin(), bytes.end()};
 }
 
-void json_parse_net_helper(BS::thread_pool<>& pool, string_view json_response, pods::net_helper& net_helper) try
+}
+
+void json_parse_net_helper(BS::thread_pool<>& pool, string_view json_response, pods::net_helper& net_helper, bool raw_ciphertext) try
 {
     if(json_response.empty())
     {
@@ -99,14 +121,14 @@ void json_parse_net_helper(BS::thread_pool<>& pool, string_view json_response, p
         }
     });
 
-    auto&& fut_groups = pool.submit_task([&json]
+    auto&& fut_groups = pool.submit_task([&json, raw_ciphertext]
     {
         try
         {
             vector<group::ptr> ret;
             for (auto& it : json["groups"].items())
             {
-                ret.push_back(make_unique<group>(json_to_group(it.value())));
+                ret.push_back(make_unique<group>(json_to_group(it.value(), false, raw_ciphertext)));
             }
 
             return ret;
@@ -119,14 +141,14 @@ void json_parse_net_helper(BS::thread_pool<>& pool, string_view json_response, p
     });
 
 
-    auto&& fut_group_fields = pool.submit_task([&json]
+    auto&& fut_group_fields = pool.submit_task([&json, raw_ciphertext]
      {
          try
          {
              vector<group_field::ptr> ret;
              for (auto& it : json["groupFields"].items())
              {
-                 ret.push_back(make_unique<group_field>(json_to_group_field(it.value())));
+                 ret.push_back(make_unique<group_field>(json_to_group_field(it.value(), false, raw_ciphertext)));
              }
 
              return ret;
@@ -139,14 +161,14 @@ void json_parse_net_helper(BS::thread_pool<>& pool, string_view json_response, p
      });
 
 
-    auto&& fut_fields = pool.submit_task([&json]
+    auto&& fut_fields = pool.submit_task([&json, raw_ciphertext]
     {
         try
      {
          vector<field::ptr> ret;
          for (auto& it : json["fields"].items())
          {
-             ret.push_back(make_unique<field>(json_to_field(it.value())));
+             ret.push_back(make_unique<field>(json_to_field(it.value(), false, raw_ciphertext)));
          }
 
          return ret;
@@ -199,28 +221,28 @@ catch (...)
     }
 }
 
-string net_helper_serialize_json(const pods::net_helper& net_helper) try
+string net_helper_serialize_json(const pods::net_helper& net_helper, bool raw_ciphertext) try
 {
     json j;
 
     auto groups = json::array();
     for(auto&& it : net_helper.groups)
     {
-        groups.push_back(serialize_json(it));
+        groups.push_back(serialize_json(it, false, raw_ciphertext));
     }
     j["groups"] = groups;
 
     auto group_fields = json::array();
     for(auto&& it : net_helper.group_fields)
     {
-        group_fields.push_back(serialize_json(it));
+        group_fields.push_back(serialize_json(it, false, raw_ciphertext));
     }
     j["groupFields"] = group_fields;
 
     auto fields = json::array();
     for(auto&& it : net_helper.fields)
     {
-        fields.push_back(serialize_json(it));
+        fields.push_back(serialize_json(it, false, raw_ciphertext));
     }
     j["fields"] = fields;
 
@@ -474,6 +496,136 @@ catch (...)
     return "";
 }
 
+database::open_options json_to_open_options(const std::string_view& str_json) try
+{
+    using synchronous_mode = database::open_options::synchronous_mode;
+
+    if(str_json.empty())
+    {
+        throw runtime_error("str_json json empty");
+    }
+
+    const auto& json = json::parse(str_json);
+
+    if (!json.is_object())
+    {
+        throw runtime_error("json is not a object");
+    }
+
+    if(!json.contains("database") || json["database"].is_null())
+    {
+        return {};
+    }
+
+    const auto& options = json["database"];
+    if(options.is_string())
+    {
+        if(auto&& ret = database::open_options::preset(options.get<string>()); ret)
+        {
+            return *ret;
+        }
+        throw runtime_error("Invalid database preset:" + options.get<string>());
+    }
+
+    if(!options.is_object())
+    {
+        throw runtime_error("Invalid type for field database");
+    }
+
+    database::open_options ret;
+    if(options.contains("preset") && options["preset"].is_string())
+    {
+        if(auto&& preset = database::open_options::preset(options["preset"].get<string>()); preset)
+        {
+            ret = *preset;
+        }
+        else
+        {
+            throw runtime_error("Invalid database preset:" + options["preset"].get<string>());
+        }
+    }
+
+    if(options.contains("busyTimeoutMs") && options["busyTimeoutMs"].is_number_unsigned())
+    {
+        ret.busy_timeout_ms = options["busyTimeoutMs"];
+    }
+    if(options.contains("wal") && options["wal"].is_boolean())
+    {
+        ret.wal = options["wal"];
+    }
+    if(options.contains("readPoolSize") && options["readPoolSize"].is_number_unsigned())
+    {
+        ret.read_pool_size = options["readPoolSize"];
+    }
+    if(options.contains("cacheSizeKib") && options["cacheSizeKib"].is_number_integer())
+    {
+        ret.cache_size_kib = options["cacheSizeKib"].get<int64_t>();
+    }
+    if(options.contains("mmapSize") && options["mmapSize"].is_number_integer())
+    {
+        ret.mmap_size = options["mmapSize"].get<int64_t>();
+    }
+    if(options.contains("pageSize") && options["pageSize"].is_number_unsigned())
+    {
+        ret.page_size = options["pageSize"].get<uint32_t>();
+    }
+    if(options.contains("tempStore") && options["tempStore"].is_string())
+    {
+        ret.temp_store_memory = options["tempStore"] == "MEMORY";
+    }
+    if(options.contains("synchronous") && options["synchronous"].is_string())
+    {
+        const string& synchronous = options["synchronous"];
+        if(synchronous == "OFF")
+        {
+            ret.synchronous = synchronous_mode::OFF;
+        }
+        else if(synchronous == "NORMAL")
+        {
+            ret.synchronous = synchronous_mode::NORMAL;
+        }
+        else if(synchronous == "FULL")
+        {
+            ret.synchronous = synchronous_mode::FULL;
+        }
+        else if(synchronous == "EXTRA")
+        {
+            ret.synchronous = synchronous_mode::EXTRA;
+        }
+        else
+        {
+            throw runtime_error("Invalid database synchronous:" + synchronous);
+        }
+    }
+    if(options.contains("lockMode") && options["lockMode"].is_string())
+    {
+        const string& lock_mode = options["lockMode"];
+        if(lock_mode == "NONE")
+        {
+            ret.mode = database::lock_mode::NONE;
+        }
+        else if(lock_mode == "PRAGMA_EXCLUSIVE")
+        {
+            ret.mode = database::lock_mode::PRAGMA_EXCLUSIVE;
+        }
+        else if(lock_mode == "WRITER_MUTEX")
+        {
+            ret.mode = database::lock_mode::WRITER_MUTEX;
+        }
+        else
+        {
+            throw runtime_error("Invalid database lockMode:" + lock_mode);
+        }
+    }
+
+    return ret;
+}
+catch (const exception& e)
+{
+    error(APP_TAG, str_json.data());
+    throw;
+}
+
 user json_to_user(const json& json)
 {
     if (!json.is_object())
@@ -549,7 +701,7 @@ user json_to_user(const json& json)
 //    return json_to_group(json::parse(str_json));
 //}
 
-group json_to_group(const json& json, bool no_id)
+group json_to_group(const json& json, bool no_id, bool raw_ciphertext)
 {
     if (!json.is_object())
     {
@@ -599,7 +751,7 @@ group json_to_group(const json& json, bool no_id)
 
     if(json.contains("title") && json["title"].is_string())
     {
-        group.title = json["title"];
+        group.title = from_wire(json["title"].get<string>(), raw_ciphertext);
     }
     else
     {
@@ -608,7 +760,7 @@ group json_to_group(const json& json, bool no_id)
 
     if(json.contains("icon") && json["icon"].is_string())
     {
-        group.icon = json["icon"];
+        group.icon = from_wire(json["icon"].get<string>(), raw_ciphertext);
     }
     else
     {
@@ -617,7 +769,7 @@ group json_to_group(const json& json, bool no_id)
 
     if(json.contains("note") && json["note"].is_string())
     {
-        group.note = json["note"];
+        group.note = from_wire(json["note"].get<string>(), raw_ciphertext);
     }
     else
     {
@@ -646,7 +798,7 @@ group json_to_group(const json& json, bool no_id)
     return group;
 }
 
-json serialize_json(const group::ptr& group, bool no_id)
+json serialize_json(const group::ptr& group, bool no_id, bool raw_ciphertext)
 {
     if(group == nullptr)
     {
@@ -662,9 +814,9 @@ json serialize_json(const group::ptr& group, bool no_id)
         j["groupId"] = group->group_id;
         j["serverGroupId"] = group->server_group_id;
     }
-    j["title"] = group->title;
-    j["icon"] = group->icon;
-    j["note"] = group->note;
+    j["title"] = to_wire(group->title, raw_ciphertext);
+    j["icon"] = to_wire(group->icon, raw_ciphertext);
+    j["note"] = to_wire(group->note, raw_ciphertext);
     j["synchronized"] = group->synchronized;
     j["deleted"] = group->deleted;
     j["timestampCreation"] = group->timestamp_creation;
@@ -682,7 +834,7 @@ json serialize_json(const group::ptr& group, bool no_id)
 //    return json_to_group_field(json::parse(str_json));
 //}
 
-group_field json_to_group_field(const json& json, bool no_id)
+group_field json_to_group_field(const json& json, bool no_id, bool raw_ciphertext)
 {
     if (!json.is_object())
     {
@@ -732,7 +884,7 @@ group_field json_to_group_field(const json& json, bool no_id)
 
     if(json.contains("title") && json["title"].is_string())
     {
-        group_field.title = json["title"];
+        group_field.title = from_wire(json["title"].get<string>(), raw_ciphertext);
     }
     else
     {
@@ -769,7 +921,7 @@ group_field json_to_group_field(const json& json, bool no_id)
     return group_field;
 }
 
-json serialize_json(const group_field::ptr& group_field, bool no_id)
+json serialize_json(const group_field::ptr& group_field, bool no_id, bool raw_ciphertext)
 {
     if(group_field == nullptr)
     {
@@ -785,7 +937,7 @@ json serialize_json(const group_field::ptr& group_field, bool no_id)
         j["groupId"] = group_field->group_id;
         j["serverGroupId"] = group_field->server_group_id;
     }
-    j["title"] = group_field->title;
+    j["title"] = to_wire(group_field->title, raw_ciphertext);
     j["isHidden"] = group_field->is_hidden;
     j["synchronized"] = group_field->synchronized;
     j["deleted"] = group_field->deleted;
@@ -795,7 +947,7 @@ json serialize_json(const group_field::ptr& group_field, bool no_id)
 }
 
 
-field json_to_field(const json& json, bool no_id)
+field json_to_field(const json& json, bool no_id, bool raw_ciphertext)
 {
     if (!json.is_object())
     {
@@ -864,7 +1016,7 @@ field json_to_field(const json& json, bool no_id)
 
     if(json.contains("title") && json["title"].is_string())
     {
-        field.title = json["title"];
+        field.title = from_wire(json["title"].get<string>(), raw_ciphertext);
     }
     else
     {
@@ -873,7 +1025,7 @@ field json_to_field(const json& json, bool no_id)
 
     if(json.contains("value") && json["value"].is_string())
     {
-        field.value = json["value"];
+        field.value = from_wire(json["value"].get<string>(), raw_ciphertext);
     }
     else
     {
@@ -960,7 +1112,7 @@ catch (...)
     return 0;
 }
 
-json serialize_json(const field::ptr& field, bool no_id)
+json serialize_json(const field::ptr& field, bool no_id, bool raw_ciphertext)
 {
     if(field == nullptr)
     {
@@ -978,8 +1130,8 @@ json serialize_json(const field::ptr& field, bool no_id)
         j["groupFieldId"] = field->group_field_id;
         j["serverGroupFieldId"] = field->server_group_field_id;
     }
-    j["title"] = field->title;
-    j["value"] = field->value;
+    j["title"] = to_wire(field->title, raw_ciphertext);
+    j["value"] = to_wire(field->value, raw_ciphertext);
     j["isHidden"] = field->is_hidden;
     j["synchronized"] = field->synchronized;
     j["deleted"] = field->deleted;
@@ -0,0 +1,173 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+
+#include "pocket-services/maintenance.hpp"
+#include "pocket-services/database.hpp"
+
+namespace pocket::services::inline v5
+{
+
+using namespace std;
+using checkpoint_mode = database::checkpoint_mode;
+
+namespace
+{
+
+constexpr int SQLITE_DEFAULT_AUTOCHECKPOINT_PAGES = 1'000;
+
+inline int64_t now() noexcept
+{
+    return chrono::steady_clock::now().time_since_epoch().count();
+}
+
+}
+
+maintenance::maintenance(database& db, sqlite3* handle, const options& options)
+: db(db)
+, handle(handle)
+, opts(options)
+, last_commit(now())
+{
+    sqlite3_wal_hook(handle, &maintenance::on_wal_commit, this);
+    worker = thread(&maintenance::loop, this);
+}
+
+maintenance::~maintenance()
+{
+    stop();
+}
+
+void maintenance::stop() noexcept
+{
+    {
+        lock_guard<mutex> lg(m);
+        if(stopping)
+        {
+            return;
+        }
+        stopping = true;
+    }
+    cv.notify_one();
+    if(worker.joinable())
+    {
+        worker.join();
+    }
+    sqlite3_wal_autocheckpoint(handle, SQLITE_DEFAULT_AUTOCHECKPOINT_PAGES);
+}
+
+maintenance::metrics maintenance::get_metrics() const
+{
+    metrics ret;
+    ret.wal_size = db.get_wal_size();
+    ret.wal_pages = wal_pages;
+    ret.freelist_pages = db.get_freelist_count();
+    ret.passive_checkpoints = passive_checkpoints;
+    ret.truncate_checkpoints = truncate_checkpoints;
+    ret.vacuumed_pages = vacuumed_pages;
+    return ret;
+}
+
+int maintenance::on_wal_commit(void* ctx, sqlite3*, const char*, int pages) noexcept
+{
+    auto self = static_cast<maintenance*>(ctx);
+    self->wal_pages = pages;
+
+    // Commits of the maintenance thread itself do not make the database busy
+    if(this_thread::get_id() != self->worker_id.load())
+    {
+        self->last_commit = now();
+    }
+
+    if(pages >= static_cast<int>(self->opts.checkpoint_pages))
+    {
+        {
+            lock_guard<mutex> lg(self->m);
+            self->checkpoint_requested = true;
+        }
+        self->cv.notify_one();
+    }
+    return SQLITE_OK;
+}
+
+void maintenance::loop() noexcept
+{
+    worker_id = this_thread::get_id();
+
+    unique_lock<mutex> ul(m);
+    while(!stopping)
+    {
+        cv.wait_for(ul, opts.tick, [this] { return stopping || checkpoint_requested; });
+        if(stopping)
+        {
+            break;
+        }
+        checkpoint_requested = false;
+
+        ul.unlock();
+        run();
+        ul.lock();
+    }
+}
+
+void maintenance::run() noexcept try
+{
+    bool idle = chrono::steady_clock::duration(now() - last_commit) >= opts.idle_after;
+    auto pages = wal_pages.load();
+
+    int log = 0;
+    int checkpointed = 0;
+    if(pages > 0 && (idle || pages >= opts.truncate_pages))
+    {
+        if(db.checkpoint(checkpoint_mode::TRUNCATE, &log, &checkpointed))
+        {
+            truncate_checkpoints++;
+            wal_pages = 0;
+        }
+    }
+    else if(pages >= opts.checkpoint_pages)
+    {
+        if(db.checkpoint(checkpoint_mode::PASSIVE, &log, &checkpointed))
+        {
+            passive_checkpoints++;
+            wal_pages = log - checkpointed;
+        }
+    }
+
+    if(idle && vacuum_supported && opts.vacuum_slice_pages > 0)
+    {
+        if(auto free = db.get_freelist_count(); free > 0 && free >= opts.vacuum_threshold_pages)
+        {
+            auto freed = db.incremental_vacuum(opts.vacuum_slice_pages);
+            if(freed == 0)
+            {
+                // Files created before auto_vacuum = INCREMENTAL need a full VACUUM to convert
+                debug(typeid(maintenance).name(), "Incremental vacuum not available on this database");
+                vacuum_supported = false;
+            }
+            vacuumed_pages += freed;
+        }
+    }
+}
+catch (const exception& e)
+{
+    error(typeid(maintenance).name(), e.what());
+}
+
+}
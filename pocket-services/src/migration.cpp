@@ -0,0 +1,143 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+
+#include "pocket-services/migration.hpp"
+#include "pocket-services/database.hpp"
+#include "pocket-services/result-set.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace pocket::services::inline v5
+{
+
+using namespace std;
+using pods::variant;
+
+namespace
+{
+
+// Listing and sync queries filter on deleted = 0 or synchronized = 0 and order by group_id, id:
+// partial indexes on (group_id, id) serve both the filter and the order without a temp b-tree.
+// The single column deleted indexes are dropped, the partial ones make them redundant.
+constexpr char MIGRATION_3[] = R"sql(
+DROP INDEX IF EXISTS groups_deleted;
+DROP INDEX IF EXISTS group_fields_deleted;
+DROP INDEX IF EXISTS fields_deleted;
+DROP INDEX IF EXISTS group_fields_group_id;
+CREATE INDEX IF NOT EXISTS groups_live ON groups (group_id, id) WHERE deleted = 0;
+CREATE INDEX IF NOT EXISTS group_fields_live ON group_fields (group_id, id) WHERE deleted = 0;
+CREATE INDEX IF NOT EXISTS fields_live ON fields (group_id, id) WHERE deleted = 0;
+CREATE INDEX IF NOT EXISTS groups_not_synchronized ON groups (group_id, id) WHERE synchronized = 0;
+CREATE INDEX IF NOT EXISTS group_fields_not_synchronized ON group_fields (group_id, id) WHERE synchronized = 0;
+CREATE INDEX IF NOT EXISTS fields_not_synchronized ON fields (group_id, id) WHERE synchronized = 0;
+CREATE INDEX IF NOT EXISTS groups_group_id ON groups (group_id, deleted);
+CREATE INDEX IF NOT EXISTS group_fields_group_id ON group_fields (group_id, deleted);
+CREATE INDEX IF NOT EXISTS fields_group_id ON fields (group_id, deleted);
+CREATE INDEX IF NOT EXISTS user_email ON user (email);
+)sql";
+
+// Opt-in raw ciphertext storage, see database::set_ciphertext_storage()
+constexpr char MIGRATION_4[] = R"sql(
+ALTER TABLE metadata ADD COLUMN ciphertext_storage INTEGER NOT NULL DEFAULT 0;
+)sql";
+
+}
+
+migrator::migrator(database& db) noexcept
+: db(db)
+{
+
+}
+
+const vector<migration>& migrator::get_migrations() noexcept
+{
+    static const vector<migration> ret = {
+        {3, "Partial and composite indexes for listing and sync queries", MIGRATION_3},
+        {4, "Ciphertext storage mode", MIGRATION_4},
+    };
+    return ret;
+}
+
+uint32_t migrator::get_version()
+{
+    auto&& rs = db.execute("SELECT version FROM metadata");
+    if(!rs || rs.value()->empty())
+    {
+        throw runtime_error("Database version not found");
+    }
+    return static_cast<uint32_t>(rs.value()->at(0).at(0).to_integer());
+}
+
+uint32_t migrator::migrate(const vector<migration>& migrations)
+{
+    auto version = get_version();
+
+    vector<const migration*> pending;
+    for(auto&& it : migrations)
+    {
+        if(it.version > version)
+        {
+            pending.push_back(&it);
+        }
+    }
+    sort(pending.begin(), pending.end(), [](auto a, auto b)
+    {
+        return a->version < b->version;
+    });
+
+    for(auto&& it : pending)
+    {
+        if(it->version != version + 1)
+        {
+            throw runtime_error("Missing migration to version " + to_string(version + 1));
+        }
+
+        info(typeid(*this).name(), "Migrate database to version " + to_string(it->version) + ": " + string(it->description));
+
+        database::transaction transaction(db);
+        string_view sql = it->sql;
+        while(!sql.empty())
+        {
+            auto end = sql.find(';');
+            string part(sql.substr(0, end));
+            trim(part);
+            sql = end == string_view::npos ? string_view{} : sql.substr(end + 1);
+            if(part.empty())
+            {
+                continue;
+            }
+
+            if(db.update(std::move(part)) < 0)
+            {
+                throw runtime_error("Migration to version " + to_string(it->version) + " failed");
+            }
+        }
+        db.update("UPDATE metadata SET version = ?", {variant(static_cast<int64_t>(it->version))});
+        transaction.commit();
+
+        version = it->version;
+    }
+
+    return version;
+}
+
+}
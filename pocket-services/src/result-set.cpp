@@ -26,103 +26,93 @@ using namespace std;
 using pods::variant;
 using enum pods::variant::type;
 
-result_set::result_set(class database& database, const std::string& query, const database::parameters& parameters)
+result_set::result_set(class database& database, sqlite3* handle, statement_cache& statements, const std::string& query, const database::parameters& parameters)
         : database(database)
+        , handle(handle)
+        , statements(statements)
 {
     
 
     debug(typeid(*this).name(), query);
-    statement_stat = sqlite3_prepare_v3(database.db, query.c_str(), static_cast<int>(query.length()), 0, &stmt, nullptr);
+    stmt = statements.acquire(handle, query, statement_stat);
     
-    // Ensure statement is always finalized using RAII-like pattern
-    auto stmt_guard = [this] 
+    // Ensure statement is always given back to the cache using RAII-like pattern
+    auto stmt_guard = [this, &query]
     {
         if(stmt != nullptr) {
-            sqlite3_finalize(stmt);
+            this->statements.release(query, stmt);
             stmt = nullptr;
         }
     };
     
     if(statement_stat == SQLITE_OK )
     {
-        for(int i = 1; auto &&param : parameters) {
-            switch (param.get_type()) {
-                default:
-                case TEXT:
-                    sqlite3_bind_text(stmt, i, param.to_text().c_str(), -1, SQLITE_TRANSIENT);
-                    debug(typeid(*this).name(), to_string(i) + ": " + param.to_text());
-                    break;
-                case INT:
-                    sqlite3_bind_int(stmt, i, static_cast<int32_t>(param.to_integer()));
-                    debug(typeid(*this).name(), to_string(i) + ": " + param.to_text());
-                    break;
-                case INT64:
-                    sqlite3_bind_int64(stmt, i, param.to_integer());
-                    debug(typeid(*this).name(), to_string(i) + ": " + param.to_text());
-                    break;
-                case DOUBLE:
-                    sqlite3_bind_double(stmt, i, param.to_float());
-                    debug(typeid(*this).name(), to_string(i) + ": " + param.to_text());
-                    break;
-            }
-            i++;
-        }
+        database::bind(stmt, parameters);
 
-        map<std::string, uint8_t> columns; //idx, sql_type
+        // Column names are resolved once per statement and shared by every row
+        auto schema = make_shared<const column_schema>(stmt);
+        const auto count = static_cast<int>(schema->size());
 
         int rc = SQLITE_DONE;
-        if (rc = sqlite3_step(stmt); rc != SQLITE_DONE && rc != SQLITE_ERROR)
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
         {
-            for (int i = 0; i < sqlite3_column_count(stmt); i++)
-            {
-                columns[sqlite3_column_name(stmt, i)] = i;
-            }
-            sqlite3_reset(stmt);
-
-            while (sqlite3_step(stmt) != SQLITE_DONE && !columns.empty())
+            vector<variant> values;
+            values.reserve(count);
+            for(int i = 0; i < count; i++)
             {
-                database::row row;
-                for(auto&& [column, i] : columns)
+                switch (sqlite3_column_type(stmt, i))
                 {
-                    switch (sqlite3_column_type(stmt, i))
-                    {
-                        case SQLITE3_TEXT:
-                            row.try_emplace(column, reinterpret_cast<const char *>(sqlite3_column_text(stmt, i)));
-                            break;
-                        case SQLITE_INTEGER:
-                            row.try_emplace(column, sqlite3_column_int(stmt, i));
-                            break;
-                        case SQLITE_FLOAT:
-                            row.try_emplace(column, sqlite3_column_double(stmt, i));
-                            break;
-                        case SQLITE_NULL:
-                            row.try_emplace(column, nullptr);
-                            break;
-                        default: break;
-                    }
+                    case SQLITE3_TEXT:
+                        values.emplace_back(string(reinterpret_cast<const char *>(sqlite3_column_text(stmt, i)), sqlite3_column_bytes(stmt, i)));
+                        break;
+                    case SQLITE_BLOB:
+                        values.emplace_back(variant::blob(string(static_cast<const char *>(sqlite3_column_blob(stmt, i)), sqlite3_column_bytes(stmt, i))));
+                        break;
+                    case SQLITE_INTEGER:
+                        values.emplace_back(sqlite3_column_int(stmt, i));
+                        break;
+                    case SQLITE_FLOAT:
+                        values.emplace_back(sqlite3_column_double(stmt, i));
+                        break;
+                    default:
+                        values.emplace_back(nullptr);
+                        break;
                 }
-
-                push_back(row);
             }
+
+            emplace_back(schema, std::move(values));
         }
-        else if (rc == SQLITE_DONE)
+
+        if (rc == SQLITE_DONE)
         {
-            total_changes = sqlite3_total_changes64(database.db);
+            total_changes = sqlite3_total_changes64(handle);
         }
         else if (rc == SQLITE_ERROR)
         {
-            stmt_guard(); // Finalize statement before throwing
-            throw runtime_error("Impossible execute query err:" + string(sqlite3_errmsg(database.db)));
+            string msg = "Impossible execute query err:" + string(sqlite3_errmsg(handle));
+            auto code = sqlite3_extended_errcode(handle);
+            stmt_guard(); // Give back statement before throwing
+            throw database_error(msg, code);
+        }
+        else
+        {
+            // SQLITE_BUSY, SQLITE_CONSTRAINT, ... are reported to the caller
+            statement_stat = rc;
+            extended_stat = sqlite3_extended_errcode(handle);
         }
 
     }
     else if(statement_stat == SQLITE_ERROR)
     {
         stmt_guard(); // Finalize statement before throwing
-        throw runtime_error("Impossible execute query err:" + string(sqlite3_errmsg(database.db)));
+        throw database_error("Impossible execute query err:" + string(sqlite3_errmsg(handle)), sqlite3_extended_errcode(handle));
+    }
+    else
+    {
+        extended_stat = sqlite3_extended_errcode(handle);
     }
     
-    // Always finalize the statement at the end
+    // Always give back the statement at the end
     stmt_guard();
 
 }
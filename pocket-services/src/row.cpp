@@ -0,0 +1,77 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+
+#include "pocket-services/row.hpp"
+
+namespace pocket::services::inline v5
+{
+
+using namespace std;
+using pods::variant;
+
+column_schema::column_schema(sqlite3_stmt* stmt)
+{
+    auto count = sqlite3_column_count(stmt);
+    names.reserve(count);
+    for(int i = 0; i < count; i++)
+    {
+        names.emplace_back(sqlite3_column_name(stmt, i));
+    }
+
+    idx.reserve(count);
+    for(int i = 0; i < count; i++)
+    {
+        idx[names[i]] = i;
+    }
+}
+
+row::row(column_schema::ptr schema, vector<variant>&& values) noexcept
+: schema(std::move(schema))
+, values(std::move(values))
+{
+
+}
+
+const variant& row::operator[](string_view name) const noexcept
+{
+    static const variant null_variant(nullptr);
+    if(schema)
+    {
+        if(auto i = schema->index_of(name); i >= 0 && static_cast<size_t>(i) < values.size())
+        {
+            return values[i];
+        }
+    }
+    return null_variant;
+}
+
+row::iterator row::find(string_view name) const noexcept
+{
+    if(schema)
+    {
+        if(auto i = schema->index_of(name); i >= 0 && static_cast<size_t>(i) < values.size())
+        {
+            return {this, static_cast<size_t>(i)};
+        }
+    }
+    return end();
+}
+
+}
@@ -0,0 +1,107 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+
+#include "pocket-services/statement-cache.hpp"
+
+namespace pocket::services::inline v5
+{
+
+using namespace std;
+
+statement_cache::statement_cache(size_t capacity) noexcept
+: capacity(capacity)
+{
+
+}
+
+statement_cache::~statement_cache()
+{
+    clear();
+}
+
+sqlite3_stmt* statement_cache::acquire(sqlite3* db, const string& query, int& rc)
+{
+    {
+        lock_guard<mutex> lg(m);
+        if(auto it = idx.find(query); it != idx.end())
+        {
+            auto stmt = it->second->second;
+            lru.erase(it->second);
+            idx.erase(it);
+            hits++;
+            rc = SQLITE_OK;
+            return stmt;
+        }
+    }
+
+    misses++;
+    sqlite3_stmt* stmt = nullptr;
+    rc = sqlite3_prepare_v3(db, query.c_str(), static_cast<int>(query.length()), SQLITE_PREPARE_PERSISTENT, &stmt, nullptr);
+    return stmt;
+}
+
+void statement_cache::release(const string& query, sqlite3_stmt* stmt) noexcept
+{
+    if(stmt == nullptr)
+    {
+        return;
+    }
+
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+
+    lock_guard<mutex> lg(m);
+    if(capacity == 0 || idx.contains(query))
+    {
+        // another caller already gave back the same query
+        sqlite3_finalize(stmt);
+        return;
+    }
+
+    lru.emplace_front(query, stmt);
+    idx[lru.front().first] = lru.begin();
+
+    if(lru.size() > capacity)
+    {
+        auto&& [last_query, last_stmt] = lru.back();
+        idx.erase(last_query);
+        sqlite3_finalize(last_stmt);
+        lru.pop_back();
+    }
+}
+
+void statement_cache::clear() noexcept
+{
+    lock_guard<mutex> lg(m);
+    idx.clear();
+    for(auto&& [query, stmt] : lru)
+    {
+        sqlite3_finalize(stmt);
+    }
+    lru.clear();
+}
+
+size_t statement_cache::size() const noexcept
+{
+    lock_guard<mutex> lg(m);
+    return lru.size();
+}
+
+}
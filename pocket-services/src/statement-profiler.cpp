@@ -0,0 +1,271 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+
+#include "pocket-services/statement-profiler.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+namespace pocket::services::inline v5
+{
+
+using namespace std;
+
+namespace
+{
+
+struct in_progress final
+{
+    const char* sql = nullptr;
+    uint64_t rows = 0;
+    chrono::steady_clock::time_point start;
+};
+
+// Statements running on this thread, moved to the profile at completion.
+// The SQL pointer guards against rows of statements SQLite runs internally while repreparing,
+// which are swapped into the user statement or leave a stale entry for a reused address.
+thread_local unordered_map<sqlite3_stmt*, in_progress> statements_in_progress;
+
+inline bool is_identifier(char c) noexcept
+{
+    return isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '`' || c == '"';
+}
+
+}
+
+void statement_profiler::attach(sqlite3* db) noexcept
+{
+    if(db)
+    {
+        sqlite3_trace_v2(db, SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE | SQLITE_TRACE_ROW, &statement_profiler::trace, this);
+    }
+}
+
+void statement_profiler::detach(sqlite3* db) noexcept
+{
+    if(db)
+    {
+        sqlite3_trace_v2(db, 0, nullptr, nullptr);
+    }
+}
+
+void statement_profiler::set_slow_query(chrono::nanoseconds threshold, slow_query_callback callback)
+{
+    lock_guard<mutex> lg(m);
+    this->threshold = threshold;
+    slow = std::move(callback);
+}
+
+vector<statement_profiler::statement_stats> statement_profiler::stats() const
+{
+    vector<statement_stats> ret;
+
+    lock_guard<mutex> lg(m);
+    ret.reserve(entries.size());
+    for(auto&& [statement, it] : entries)
+    {
+        statement_stats s;
+        s.statement = statement;
+        s.count = it.count;
+        s.rows = it.rows;
+        s.total = chrono::nanoseconds(it.total_ns);
+        s.avg = chrono::nanoseconds(it.count ? it.total_ns / it.count : 0);
+        s.max = chrono::nanoseconds(it.max_ns);
+        if(!it.samples.empty())
+        {
+            auto samples = it.samples;
+            auto p99 = samples.begin() + (samples.size() * 99) / 100;
+            if(p99 == samples.end())
+            {
+                p99--;
+            }
+            nth_element(samples.begin(), p99, samples.end());
+            s.p99 = chrono::nanoseconds(*p99);
+        }
+        ret.push_back(std::move(s));
+    }
+
+    sort(ret.begin(), ret.end(), [](auto&& a, auto&& b)
+    {
+        return a.total > b.total;
+    });
+    return ret;
+}
+
+void statement_profiler::reset() noexcept
+{
+    lock_guard<mutex> lg(m);
+    raw.clear();
+    entries.clear();
+}
+
+string statement_profiler::normalize(string_view sql)
+{
+    string ret;
+    ret.reserve(sql.size());
+
+    for(size_t i = 0; i < sql.size(); i++)
+    {
+        char c = sql[i];
+        if(c == '\'')
+        {
+            // String literal, '' is an escaped quote
+            for(i++; i < sql.size(); i++)
+            {
+                if(sql[i] == '\'')
+                {
+                    if(i + 1 < sql.size() && sql[i + 1] == '\'')
+                    {
+                        i++;
+                        continue;
+                    }
+                    break;
+                }
+            }
+            ret += '?';
+        }
+        else if(isdigit(static_cast<unsigned char>(c)) && (ret.empty() || !is_identifier(ret.back())))
+        {
+            while(i + 1 < sql.size() && (isalnum(static_cast<unsigned char>(sql[i + 1])) || sql[i + 1] == '.'))
+            {
+                i++;
+            }
+            ret += '?';
+        }
+        else if(isspace(static_cast<unsigned char>(c)))
+        {
+            if(!ret.empty() && ret.back() != ' ')
+            {
+                ret += ' ';
+            }
+        }
+        else
+        {
+            ret += c;
+        }
+    }
+
+    while(!ret.empty() && (ret.back() == ' ' || ret.back() == ';'))
+    {
+        ret.pop_back();
+    }
+    return ret;
+}
+
+int statement_profiler::trace(unsigned type, void* ctx, void* p, void* x) noexcept
+{
+    auto stmt = static_cast<sqlite3_stmt*>(p);
+    if(type == SQLITE_TRACE_STMT)
+    {
+        // Trigger programs report "-- comment" text, they belong to the outer statement
+        if(auto text = static_cast<const char*>(x); text == nullptr || text[0] != '-' || text[1] != '-')
+        {
+            statements_in_progress[stmt] = {sqlite3_sql(stmt), 0, chrono::steady_clock::now()};
+        }
+    }
+    else if(type == SQLITE_TRACE_ROW)
+    {
+        auto sql = sqlite3_sql(stmt);
+        auto&& it = statements_in_progress[stmt];
+        if(it.sql != sql)
+        {
+            it = {sql, 0, {}};
+        }
+        it.rows++;
+    }
+    else if(type == SQLITE_TRACE_PROFILE)
+    {
+        // SQLite measures with the VFS clock, milliseconds on most platforms
+        uint64_t ns = *static_cast<sqlite3_uint64*>(x);
+        uint64_t rows = 0;
+        if(auto it = statements_in_progress.find(stmt); it != statements_in_progress.end())
+        {
+            if(it->second.sql == sqlite3_sql(stmt))
+            {
+                rows = it->second.rows;
+                if(it->second.start != chrono::steady_clock::time_point{})
+                {
+                    ns = max<uint64_t>(ns, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - it->second.start).count());
+                }
+            }
+            statements_in_progress.erase(it);
+        }
+        static_cast<statement_profiler*>(ctx)->record(stmt, ns, rows);
+    }
+    return 0;
+}
+
+void statement_profiler::record(sqlite3_stmt* stmt, uint64_t ns, uint64_t rows) noexcept try
+{
+    const char* sql = sqlite3_sql(stmt);
+    if(sql == nullptr)
+    {
+        return;
+    }
+
+    slow_query_callback callback;
+    {
+        lock_guard<mutex> lg(m);
+
+        entry* e = nullptr;
+        if(auto it = raw.find(sql); it != raw.end())
+        {
+            e = it->second;
+        }
+        else
+        {
+            if(raw.size() >= MAX_RAW_STATEMENTS)
+            {
+                raw.clear();
+            }
+            e = &entries[normalize(sql)];
+            raw.emplace(sql, e);
+        }
+
+        if(e->samples.size() < SAMPLES)
+        {
+            e->samples.push_back(ns);
+        }
+        else
+        {
+            e->samples[e->count % SAMPLES] = ns;
+        }
+        e->count++;
+        e->rows += rows;
+        e->total_ns += ns;
+        e->max_ns = max(e->max_ns, ns);
+
+        if(slow && threshold.count() > 0 && ns >= static_cast<uint64_t>(threshold.count()))
+        {
+            callback = slow;
+        }
+    }
+
+    if(callback)
+    {
+        callback(sql, chrono::nanoseconds(ns));
+    }
+}
+catch (const exception& e)
+{
+    error(typeid(statement_profiler).name(), e.what());
+}
+
+}
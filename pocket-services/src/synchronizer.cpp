@@ -266,7 +266,7 @@ pods::user::opt_ptr synchronizer::send_data(const pods::user::ptr& user)
 
             auto crypt = crypto_encrypt_rsa(device.host_pub_key, to_string(device.id) + DIVISOR + secret  + DIVISOR + to_string(timestamp_last_update) + DIVISOR + email + DIVISOR + passwd) ;
 
-            auto&& data = net_helper_serialize_json(ret.get());
+            auto&& data = net_helper_serialize_json(ret.get(), database->is_ciphertext_raw());
 
             debug("send_data", "timestamp_last_update: " + to_string(timestamp_last_update) + " " + data);
             
@@ -545,6 +545,8 @@ bool synchronizer::heartbeat(const pods::user::ptr& user, uint64_t& timestamp_la
 
 pods::user::opt_ptr synchronizer::parse_data_from_net(const std::string_view& response, server_id_helper& data)
 {
+    services::database::io_tag tag("sync.apply");
+
     if(!response.starts_with(ERROR_HTTP_CODE))
     {
         set_status(stat::BUSY);
@@ -554,7 +556,7 @@ pods::user::opt_ptr synchronizer::parse_data_from_net(const std::string_view& re
             struct net_helper net_helper;
             try
             {
-                json_parse_net_helper(pool, response, net_helper);
+                json_parse_net_helper(pool, response, net_helper, database->is_ciphertext_raw());
             }
             catch (const runtime_error& e)
             {
@@ -569,6 +571,8 @@ pods::user::opt_ptr synchronizer::parse_data_from_net(const std::string_view& re
                 return nullopt;
             }
 
+            database::transaction transaction(*database);
+
             auto&& fut_group = update_database_table<group>(net_helper.get_vector_ref<group>(), data);
             if(!fut_group)
             {
@@ -593,6 +597,8 @@ pods::user::opt_ptr synchronizer::parse_data_from_net(const std::string_view& re
                 return nullopt;
             }
 
+            transaction.commit();
+
             timestamp_last_update = net_helper.timestamp_last_update;
 
             set_status(stat::READY);
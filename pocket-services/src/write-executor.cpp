@@ -0,0 +1,182 @@
+/***************************************************************************
+ *
+ * Pocket
+ * Copyright (C) 2018/2025 Antonio Salsi <passy.linux@zresa.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***************************************************************************/
+
+
+#include "pocket-services/write-executor.hpp"
+#include "pocket-services/database.hpp"
+
+#include <cassert>
+
+namespace pocket::services::inline v5
+{
+
+using namespace std;
+
+write_executor::write_executor(database& db, chrono::microseconds window, size_t max_batch)
+: db(db)
+, window(window)
+, max_batch(max_batch > 0 ? max_batch : 1)
+{
+    worker = thread(&write_executor::loop, this);
+}
+
+write_executor::~write_executor()
+{
+    stop();
+}
+
+void write_executor::stop()
+{
+    if(stopping.exchange(true))
+    {
+        return;
+    }
+
+    signal.fetch_add(1, memory_order_release);
+    signal.notify_one();
+    if(worker.joinable())
+    {
+        worker.join();
+    }
+
+    // A submit() that passed the stopping check before it was set is still pushing
+    for(auto n = submitting.load(); n > 0; n = submitting.load())
+    {
+        submitting.wait(n);
+    }
+
+    // Jobs pushed while the writer thread was exiting
+    vector<job*> batch;
+    while(pending > 0)
+    {
+        collect(batch);
+        execute(db, batch);
+        batch.clear();
+    }
+}
+
+void write_executor::loop()
+{
+    vector<job*> batch;
+    batch.reserve(max_batch);
+    while(true)
+    {
+        auto seen = signal.load(memory_order_acquire);
+
+        while(pending > 0)
+        {
+            collect(batch);
+
+            // Give concurrent writers the chance to join this transaction
+            if(batch.size() < max_batch && window.count() > 0 && !stopping)
+            {
+                this_thread::sleep_for(window);
+                collect(batch);
+            }
+
+            batches++;
+            jobs += batch.size();
+            execute(db, batch);
+            batch.clear();
+        }
+
+        if(stopping)
+        {
+            break;
+        }
+
+        signal.wait(seen, memory_order_acquire);
+    }
+}
+
+void write_executor::check_caller() const noexcept
+{
+    // The writer thread runs one job at a time: a job waiting on another one waits forever
+    assert(this_thread::get_id() != worker.get_id() && "submit() from inside a write job");
+
+    // The writer thread begins its transaction only when this thread ends the one it owns
+    assert(!db.owns_transaction() && "submit() while owning a database::transaction");
+}
+
+void write_executor::collect(vector<job*>& batch)
+{
+    while(batch.size() < max_batch && pending.load(memory_order_acquire) > 0)
+    {
+        auto n = queue.pop();
+        if(n == nullptr)
+        {
+            // A producer is between exchange and link
+            this_thread::yield();
+            continue;
+        }
+        pending.fetch_sub(1, memory_order_acq_rel);
+        batch.push_back(static_cast<job*>(n));
+    }
+}
+
+void write_executor::execute(database& db, vector<job*>& batch) noexcept
+{
+    try
+    {
+        database::transaction transaction(db);
+        for(auto&& it : batch)
+        {
+            try
+            {
+                // A failing job rolls back only its own savepoint
+                database::transaction savepoint(db);
+                it->run(db);
+                savepoint.commit();
+            }
+            catch (...)
+            {
+                it->fail(current_exception());
+                delete it;
+                it = nullptr;
+            }
+        }
+        transaction.commit();
+    }
+    catch (const exception& e)
+    {
+        error(typeid(write_executor).name(), e.what());
+        for(auto&& it : batch)
+        {
+            if(it)
+            {
+                it->fail(current_exception());
+                delete it;
+                it = nullptr;
+            }
+        }
+        return;
+    }
+
+    for(auto&& it : batch)
+    {
+        if(it)
+        {
+            it->complete();
+            delete it;
+            it = nullptr;
+        }
+    }
+}
+
+}
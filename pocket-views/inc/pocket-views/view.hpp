@@ -41,7 +41,7 @@ namespace pocket::views::inline v5
 template<iface::require_pod T>
 class view final
 {
-    services::aes aes;
+    std::shared_ptr<const services::aes> aes;
 
     services::database::ptr& database;
     daos::dao dao;
@@ -50,12 +50,12 @@ public:
     using ptr = std::unique_ptr<view>;
 
     explicit view(const pods::user::ptr &user, services::database::ptr& database, const std::string_view& aes_cbc_iv, bool enable_aes = true) noexcept
-    : aes(aes_cbc_iv, user->passwd)
+    : aes(std::make_shared<const services::aes>(aes_cbc_iv, user->passwd, database && database->is_ciphertext_raw()))
     , database(database)
     , dao(database)
     , enable_aes(enable_aes)
     {
-
+        bind_cipher();
     } 
 
     POCKET_NO_COPY_NO_MOVE(view)
@@ -64,6 +64,7 @@ public:
     inline void set_enable_aes(bool enable_aes) noexcept
     {
         this->enable_aes = enable_aes;
+        bind_cipher();
     }
 
     std::optional<typename T::ptr> get(int64_t id)
@@ -76,9 +77,11 @@ public:
         return ret;
     }
 
-    daos::dao::list<T> get_list(int64_t group_id, std::string search = "") const
+    // Filtered, sorted and paged by SQLite on the decrypted titles, only the rows of the page are decrypted here
+    daos::dao::list<T> get_list(int64_t group_id, std::string search = "", size_t limit = 0, size_t offset = 0) const
     {
-        auto&& ret = dao.get_all<T>(group_id, false);
+        services::database::io_tag tag("view.get_list");
+        auto&& ret = dao.get_list<T>(group_id, search, limit, offset, enable_aes);
         if(enable_aes)
         {
             for(auto&& it : ret)
@@ -86,30 +89,6 @@ public:
                 decrypt(it);
             }
         }
-    
-        if(!search.empty())
-        {
-            daos::dao::list<T> ret_filtered;
-            for(auto&& it : ret)
-            {
-                std::transform(search.cbegin(), search.cend(), search.begin(), [](char c){ return std::tolower(c); });
-
-                std::string title_low = it->title;
-                std::transform(title_low.cbegin(), title_low.cend(), title_low.begin(), [](char c){ return std::tolower(c); });
-
-                if(title_low.find(search) != std::string::npos)
-                {
-                    ret_filtered.push_back(std::move(it));
-                }
-            }
-            ret = std::move(ret_filtered);
-        }
-        
-        sort(ret.begin(), ret.end(), [](auto &v1, auto &v2)
-        {
-            return v1->title < v2->title;
-        });
-        
         return ret;
     }
 
@@ -187,29 +166,38 @@ public:
 
     int64_t get_last_id() const = delete;
 private:
+    // pocket_decrypt() in the queries of get_list() decrypts with the key of this view
+    inline void bind_cipher() noexcept
+    {
+        if(database && enable_aes)
+        {
+            database->set_cipher(aes);
+        }
+    }
+
     constexpr void encrypt(T::ptr& it) const
     {
         if(!it->title.empty())
         {
-            it->title = aes.encrypt(it->title);
+            it->title = aes->encrypt(it->title);
         }
         
         if constexpr(std::is_same_v<T, pods::group>)
         {
             if(!it->icon.empty())
             {
-                it->icon = aes.encrypt(it->icon);
+                it->icon = aes->encrypt(it->icon);
             }
             if(!it->note.empty())
             {
-                it->note = aes.encrypt(it->note);
+                it->note = aes->encrypt(it->note);
             }
         }
         if constexpr(std::is_same_v<T, pods::field>)
         {
             if(!it->value.empty())
             {
-                it->value = aes.encrypt(it->value);
+                it->value = aes->encrypt(it->value);
             }
         }
     }
@@ -218,25 +206,25 @@ private:
     {
         if(!it->title.empty())
         {
-            it->title = aes.decrypt(it->title);
+            it->title = aes->decrypt(it->title);
         }
 
         if constexpr(std::is_same_v<T, pods::group>)
         {
             if(!it->icon.empty())
             {
-                it->icon = aes.decrypt(it->icon);
+                it->icon = aes->decrypt(it->icon);
             }
             if(!it->note.empty())
             {
-                it->note = aes.decrypt(it->note);
+                it->note = aes->decrypt(it->note);
             }
         }
         if constexpr(std::is_same_v<T, pods::field>)
         {
             if(!it->value.empty())
             {
-                it->value = aes.decrypt(it->value);
+                it->value = aes->decrypt(it->value);
             }
         }
     }
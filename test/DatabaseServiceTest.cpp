@@ -21,9 +21,25 @@
 #include "pocket-services/database.hpp"
 #include "pocket-services/result-set.hpp"
 #include "pocket-pods/variant.hpp"
+#include "pocket-pods/field.hpp"
+#include "pocket-daos/dao.hpp"
+#include "pocket-daos/memory-storage.hpp"
+#include "pocket-daos/table-descriptor.hpp"
+#include "pocket-views/view.hpp"
+#include "pocket-services/crypto.hpp"
+#include "pocket-services/crypto-vfs.hpp"
 #include <filesystem>
+#include <fstream>
+#include <iterator>
 #include <thread>
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <optional>
+#include <set>
 
 using namespace pocket::services;
 using namespace pocket::pods;
@@ -51,6 +67,16 @@ protected:
     }
 };
 
+// Benchmarks only print timings, they run when POCKET_BENCHMARK_ROWS sets the size of their data set
+static std::optional<size_t> benchmark_rows()
+{
+    if(auto env = std::getenv("POCKET_BENCHMARK_ROWS"); env)
+    {
+        return std::stoul(env);
+    }
+    return std::nullopt;
+}
+
 // Test database creation and opening
 TEST_F(DatabaseServiceTest, OpenNewDatabase)
 {
@@ -191,4 +217,1674 @@ TEST_F(DatabaseServiceTest, TransactionCommit)
     auto select_result = db->execute("SELECT * FROM user WHERE email = 'test@example.com'");
     ASSERT_TRUE(select_result.has_value());
     EXPECT_EQ(select_result.value()->size(), 1);
-}
\ No newline at end of file
+}
+
+TEST_F(DatabaseServiceTest, StatementCacheReuse)
+{
+    ASSERT_TRUE(db->open(test_db_path));
+
+    auto&& cache = db->get_statement_cache();
+    auto misses = cache.get_misses();
+    auto hits = cache.get_hits();
+
+    for(int i = 0; i < 3; i++)
+    {
+        EXPECT_GE(db->update("UPDATE user SET status = ? WHERE id = ?", {variant(i), variant(i)}), 0);
+    }
+
+    EXPECT_EQ(cache.get_misses(), misses + 1);
+    EXPECT_EQ(cache.get_hits(), hits + 2);
+
+    db->close();
+    EXPECT_EQ(cache.size(), 0);
+}
+
+TEST_F(DatabaseServiceTest, TransactionRollbackOnScopeExit)
+{
+    ASSERT_TRUE(db->open(test_db_path));
+
+    {
+        database::transaction transaction(*db);
+        EXPECT_TRUE(db->in_transaction());
+        db->update("INSERT INTO user (name, email, passwd) VALUES ('a', 'rollback@example.com', 'x')");
+    }
+    EXPECT_FALSE(db->in_transaction());
+
+    auto result = db->execute("SELECT * FROM user WHERE email = 'rollback@example.com'");
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result.value()->size(), 0);
+}
+
+TEST_F(DatabaseServiceTest, NestedTransaction)
+{
+    ASSERT_TRUE(db->open(test_db_path));
+
+    {
+        database::transaction outer(*db);
+        db->update("INSERT INTO user (name, email, passwd) VALUES ('a', 'outer@example.com', 'x')");
+        {
+            database::transaction inner(*db);
+            db->update("INSERT INTO user (name, email, passwd) VALUES ('b', 'inner@example.com', 'x')");
+            inner.rollback();
+        }
+        {
+            database::transaction inner(*db);
+            db->update("INSERT INTO user (name, email, passwd) VALUES ('c', 'inner2@example.com', 'x')");
+            inner.commit();
+        }
+        outer.commit();
+    }
+
+    auto result = db->execute("SELECT email FROM user ORDER BY id");
+    ASSERT_TRUE(result.has_value());
+    ASSERT_EQ(result.value()->size(), 2);
+    EXPECT_EQ(result.value()->at(0).find("email")->second.to_text(), "outer@example.com");
+    EXPECT_EQ(result.value()->at(1).find("email")->second.to_text(), "inner2@example.com");
+}
+
+TEST_F(DatabaseServiceTest, FailedCommitRollsBack)
+{
+    ASSERT_TRUE(db->open(test_db_path));
+    db->update("PRAGMA foreign_keys = ON");
+    db->update("CREATE TABLE parent (id INTEGER PRIMARY KEY)");
+    db->update("CREATE TABLE child (parent_id INTEGER REFERENCES parent (id) DEFERRABLE INITIALLY DEFERRED)");
+
+    {
+        database::transaction transaction(*db);
+        db->update("INSERT INTO child (parent_id) VALUES (42)");
+        // The deferred foreign key fails COMMIT and SQLite keeps the transaction open
+        EXPECT_THROW(transaction.commit(), std::runtime_error);
+    }
+    EXPECT_FALSE(db->in_transaction());
+
+    // BEGIN would fail inside the transaction left open
+    {
+        database::transaction transaction(*db);
+        db->update("INSERT INTO parent (id) VALUES (1)");
+        transaction.commit();
+    }
+
+    auto result = db->execute("SELECT (SELECT count(*) FROM child) AS children, (SELECT count(*) FROM parent) AS parents");
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result.value()->at(0)["children"].to_integer(), 0);
+    EXPECT_EQ(result.value()->at(0)["parents"].to_integer(), 1);
+}
+
+TEST_F(DatabaseServiceTest, ReadPoolDuringWriteTransaction)
+{
+    ASSERT_TRUE(db->open(test_db_path));
+    if(db->get_read_pool().get_max_size() == 0)
+    {
+        GTEST_SKIP() << "Read pool disabled";
+    }
+
+    db->update("INSERT INTO user (name, email, passwd) VALUES ('a', 'committed@example.com', 'x')");
+
+    database::transaction transaction(*db);
+    db->update("INSERT INTO user (name, email, passwd) VALUES ('b', 'pending@example.com', 'x')");
+
+    // The writer thread sees its own uncommitted row
+    auto own = db->execute("SELECT COUNT(*) AS count FROM user");
+    ASSERT_TRUE(own.has_value());
+    EXPECT_EQ(own.value()->at(0).find("count")->second.to_integer(), 2);
+
+    std::atomic<int> committed_only = 0;
+    std::vector<std::thread> readers;
+    for(int i = 0; i < 4; i++)
+    {
+        readers.emplace_back([this, &committed_only]
+        {
+            auto result = db->execute("SELECT COUNT(*) AS count FROM user");
+            if(result && result.value()->at(0).find("count")->second.to_integer() == 1)
+            {
+                committed_only++;
+            }
+        });
+    }
+    for(auto&& it : readers)
+    {
+        it.join();
+    }
+
+    EXPECT_EQ(committed_only, 4);
+    EXPECT_GT(db->get_read_pool().size(), 0);
+    transaction.commit();
+}
+
+TEST_F(DatabaseServiceTest, QueryStreamsRows)
+{
+    ASSERT_TRUE(db->open(test_db_path));
+
+    for(int i = 0; i < 5; i++)
+    {
+        db->update("INSERT INTO user (name, email, passwd, status) VALUES (?, ?, 'x', ?)", {variant("user " + std::to_string(i)), variant(std::to_string(i) + "@example.com"), variant(i)});
+    }
+
+    std::vector<std::string> names;
+    int64_t status_sum = 0;
+    auto rows = db->query("SELECT name, status FROM user ORDER BY id", {}, [&](const cursor& c)
+    {
+        EXPECT_EQ(c.column_count(), 2);
+        EXPECT_EQ(c.column_index("missing"), -1);
+        names.emplace_back(c.get_text("name"));
+        status_sum += c.get_integer(c.column_index("status"));
+        return true;
+    });
+
+    EXPECT_EQ(rows, 5);
+    ASSERT_EQ(names.size(), 5);
+    EXPECT_EQ(names[0], "user 0");
+    EXPECT_EQ(status_sum, 10);
+
+    // Returning false stops stepping
+    rows = db->query("SELECT id FROM user WHERE status >= ?", {variant(1)}, [](const cursor&) { return false; });
+    EXPECT_EQ(rows, 1);
+
+    EXPECT_THROW(db->query("SELECT * FROM not_exists", {}, [](const cursor&) { return true; }), std::runtime_error);
+}
+
+TEST_F(DatabaseServiceTest, WriterMutexWaitsForTransaction)
+{
+    ASSERT_TRUE(db->open(test_db_path, database::lock_mode::WRITER_MUTEX));
+    EXPECT_EQ(db->get_lock_mode(), database::lock_mode::WRITER_MUTEX);
+
+    std::atomic<bool> written = false;
+    std::thread other;
+    {
+        database::transaction transaction(*db);
+        db->update("INSERT INTO user (name, email, passwd) VALUES ('a', 'owner@example.com', 'x')");
+
+        // The other thread blocks on the writer mutex instead of failing with SQLITE_BUSY
+        other = std::thread([this, &written]
+        {
+            EXPECT_GT(db->update("INSERT INTO user (name, email, passwd) VALUES ('b', 'other@example.com', 'x')"), 0);
+            written = true;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        EXPECT_FALSE(written);
+        transaction.commit();
+    }
+    other.join();
+    EXPECT_TRUE(written);
+
+    auto result = db->execute("SELECT COUNT(*) AS count FROM user");
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result.value()->at(0).find("count")->second.to_integer(), 2);
+}
+
+TEST_F(DatabaseServiceTest, LockModeOverheadBenchmark)
+{
+    auto rows = benchmark_rows();
+    if(!rows)
+    {
+        GTEST_SKIP() << "POCKET_BENCHMARK_ROWS not set";
+    }
+    const int iterations = static_cast<int>(*rows);
+
+    struct timings
+    {
+        int64_t update = 0;
+        int64_t select = 0;
+    };
+
+    auto measure = [this, iterations](database::lock_mode mode)
+    {
+        timings ret;
+        EXPECT_TRUE(db->open(test_db_path, mode));
+        db->update("INSERT OR REPLACE INTO user (id, name, email, passwd) VALUES (1, 'a', 'bench@example.com', 'x')");
+
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < iterations; i++)
+        {
+            db->update("UPDATE user SET timestamp_last_update = ? WHERE id = 1", {variant(i)});
+        }
+        ret.update = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        for(int i = 0; i < iterations; i++)
+        {
+            auto result = db->execute("SELECT name FROM user WHERE id = 1");
+            EXPECT_TRUE(result.has_value() && result.value()->size() == 1);
+        }
+        ret.select = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+        db->close();
+        return ret;
+    };
+
+    auto pragma = measure(database::lock_mode::PRAGMA_EXCLUSIVE);
+    auto writer = measure(database::lock_mode::WRITER_MUTEX);
+
+    std::cout << "x" << iterations << " pragma locking_mode update: " << pragma.update / double(iterations) << "us select: " << pragma.select / double(iterations) << "us"
+              << " writer mutex update: " << writer.update / double(iterations) << "us select: " << writer.select / double(iterations) << "us" << std::endl;
+}
+
+TEST_F(DatabaseServiceTest, ExecutorGroupCommit)
+{
+    ASSERT_TRUE(db->open(test_db_path));
+    db->start_executor(std::chrono::milliseconds(20));
+
+    constexpr int threads = 4;
+    constexpr int per_thread = 25;
+    std::vector<std::future<int64_t>> futures[threads];
+    std::vector<std::thread> producers;
+    for(int t = 0; t < threads; t++)
+    {
+        producers.emplace_back([this, t, &futures]
+        {
+            for(int i = 0; i < per_thread; i++)
+            {
+                futures[t].push_back(db->submit([t, i](database& db)
+                {
+                    db.update("INSERT INTO user (name, email, passwd) VALUES (?, ?, 'x')",
+                              {variant("user"), variant(std::to_string(t) + "_" + std::to_string(i) + "@example.com")});
+                    return db.get_last_insert_rowid();
+                }));
+            }
+        });
+    }
+    for(auto&& it : producers)
+    {
+        it.join();
+    }
+
+    for(auto&& it : futures)
+    {
+        for(auto&& future : it)
+        {
+            EXPECT_GT(future.get(), 0);
+        }
+    }
+
+    ASSERT_NE(db->get_executor(), nullptr);
+    EXPECT_EQ(db->get_executor()->get_jobs(), threads * per_thread);
+    EXPECT_LT(db->get_executor()->get_batches(), threads * per_thread);
+
+    auto result = db->execute("SELECT COUNT(*) AS count FROM user");
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result.value()->at(0).find("count")->second.to_integer(), threads * per_thread);
+}
+
+TEST_F(DatabaseServiceTest, ExecutorFailingJobRollsBackAlone)
+{
+    ASSERT_TRUE(db->open(test_db_path));
+    db->start_executor(std::chrono::milliseconds(20));
+
+    auto failing = db->submit([](database& db)
+    {
+        db.update("INSERT INTO user (name, email, passwd) VALUES ('a', 'failing@example.com', 'x')");
+        throw std::runtime_error("job error");
+    });
+    auto ok = db->submit([](database& db)
+    {
+        db.update("INSERT INTO user (name, email, passwd) VALUES ('b', 'ok@example.com', 'x')");
+    });
+
+    EXPECT_THROW(failing.get(), std::runtime_error);
+    EXPECT_NO_THROW(ok.get());
+    db->stop_executor();
+
+    auto result = db->execute("SELECT email FROM user");
+    ASSERT_TRUE(result.has_value());
+    ASSERT_EQ(result.value()->size(), 1);
+    EXPECT_EQ(result.value()->at(0)["email"].to_text(), "ok@example.com");
+}
+
+TEST_F(DatabaseServiceTest, ExecutorStopResolvesEverySubmit)
+{
+    ASSERT_TRUE(db->open(test_db_path));
+    db->start_executor(std::chrono::microseconds(100));
+
+    constexpr int threads = 4;
+    std::atomic<bool> go = false;
+    std::atomic<int> rejected = 0;
+    std::vector<std::future<void>> futures[threads];
+    std::vector<std::thread> producers;
+    for(int t = 0; t < threads; t++)
+    {
+        producers.emplace_back([&, t]
+        {
+            while(!go)
+            {
+                std::this_thread::yield();
+            }
+            for(int i = 0; i < 200; i++)
+            {
+                try
+                {
+                    futures[t].push_back(db->submit([](database& db)
+                    {
+                        db.update("INSERT INTO metadata (version) VALUES (0)");
+                    }));
+                }
+                catch (const std::runtime_error&)
+                {
+                    rejected++;
+                }
+            }
+        });
+    }
+
+    auto count = [this]
+    {
+        return db->execute("SELECT count(*) AS count FROM metadata").value()->at(0)["count"].to_integer();
+    };
+    auto before = count();
+
+    go = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    db->stop_executor();
+    for(auto&& it : producers)
+    {
+        it.join();
+    }
+
+    // Accepted before the stop: run by the executor. After: run inline. In between: rejected
+    int64_t accepted = 0;
+    for(auto&& it : futures)
+    {
+        for(auto&& future : it)
+        {
+            ASSERT_EQ(future.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+            EXPECT_NO_THROW(future.get());
+            accepted++;
+        }
+    }
+    EXPECT_EQ(accepted + rejected, threads * 200);
+    EXPECT_EQ(count() - before, accepted);
+}
+
+#ifndef NDEBUG
+TEST_F(DatabaseServiceTest, ExecutorSubmitInsideTransactionAsserts)
+{
+    GTEST_FLAG_SET(death_test_style, "threadsafe");
+    ASSERT_TRUE(db->open(test_db_path));
+    db->start_executor();
+
+    EXPECT_DEATH(
+    {
+        database::transaction transaction(*db);
+        db->submit([](database&) {}).wait();
+    }, "owning a database::transaction");
+}
+#endif
+
+TEST_F(DatabaseServiceTest, SubmitWithoutExecutorRunsInline)
+{
+    ASSERT_TRUE(db->open(test_db_path));
+
+    auto future = db->submit([](database& db)
+    {
+        return db.update("INSERT INTO user (name, email, passwd) VALUES ('a', 'inline@example.com', 'x')");
+    });
+    ASSERT_EQ(future.wait_for(std::chrono::seconds(0)), std::future_status::ready);
+    EXPECT_GT(future.get(), 0);
+    EXPECT_EQ(db->get_executor(), nullptr);
+}
+
+TEST_F(DatabaseServiceTest, ProfilingGroupsNormalizedStatements)
+{
+    ASSERT_TRUE(db->open(test_db_path));
+    db->update("INSERT INTO user (name, email, passwd) VALUES ('a', 'profile@example.com', 'x')");
+
+    std::atomic<int> slow = 0;
+    db->set_slow_query_callback(std::chrono::nanoseconds(1), [&slow](const std::string&, std::chrono::nanoseconds)
+    {
+        slow++;
+    });
+    db->set_profiling(true);
+    EXPECT_TRUE(db->is_profiling());
+
+    // Same query with inlined ids, the N+1 shape the profiler has to expose
+    for(int i = 0; i < 10; i++)
+    {
+        auto result = db->execute("SELECT * FROM user WHERE id = " + std::to_string(i % 2 + 1));
+        ASSERT_TRUE(result.has_value());
+    }
+
+    auto stats = db->stats();
+    auto it = std::find_if(stats.begin(), stats.end(), [](auto&& s) { return s.statement == "SELECT * FROM user WHERE id = ?"; });
+    ASSERT_NE(it, stats.end());
+    EXPECT_EQ(it->count, 10);
+    EXPECT_EQ(it->rows, 5);
+    EXPECT_GT(it->total.count(), 0);
+    EXPECT_GE(it->max, it->p99);
+    EXPECT_GE(slow, 10);
+
+    db->reset_stats();
+    EXPECT_TRUE(db->stats().empty());
+
+    db->set_profiling(false);
+    db->execute("SELECT * FROM user");
+    EXPECT_TRUE(db->stats().empty());
+}
+
+TEST_F(DatabaseServiceTest, ProfilerNormalize)
+{
+    EXPECT_EQ(statement_profiler::normalize("SELECT  *\n FROM groups WHERE id = 12 AND title = 'it''s' ;"), "SELECT * FROM groups WHERE id = ? AND title = ?");
+    EXPECT_EQ(statement_profiler::normalize("SELECT * FROM t1 WHERE value > 1.5"), "SELECT * FROM t1 WHERE value > ?");
+}
+
+TEST_F(DatabaseServiceTest, OpenOptionsPresetsApplied)
+{
+    ASSERT_TRUE(db->open(test_db_path, database::open_options::desktop_throughput()));
+
+    auto result = db->execute("PRAGMA synchronous");
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result.value()->at(0).at(0).to_integer(), 1);
+
+    result = db->execute("PRAGMA page_size");
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result.value()->at(0).at(0).to_integer(), 8'192);
+
+    result = db->execute("PRAGMA cache_size");
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result.value()->at(0).at(0).to_integer(), -64 * 1'024);
+
+    EXPECT_EQ(db->get_open_options().read_pool_size, database::open_options::desktop_throughput().read_pool_size);
+    EXPECT_FALSE(database::open_options::preset("unknown").has_value());
+}
+
+TEST_F(DatabaseServiceTest, OpenOptionsBenchmark)
+{
+    // POCKET_BENCHMARK_ROWS=100000 for the large data set
+    auto env_rows = benchmark_rows();
+    if(!env_rows)
+    {
+        GTEST_SKIP() << "POCKET_BENCHMARK_ROWS not set";
+    }
+    const size_t rows = *env_rows;
+
+    std::pair<const char*, database::open_options> presets[] = {
+        {"default", {}},
+        {"mobile_low_memory", database::open_options::mobile_low_memory()},
+        {"desktop_throughput", database::open_options::desktop_throughput()},
+        {"read_mostly", database::open_options::read_mostly()},
+    };
+
+    for(auto&& [name, options] : presets)
+    {
+        db->close();
+        std::filesystem::remove(test_db_path);
+        std::filesystem::remove(test_db_path + "-wal");
+        std::filesystem::remove(test_db_path + "-shm");
+        ASSERT_TRUE(db->open(test_db_path, options));
+        pocket::daos::dao dao(db);
+
+        // Sync apply: one persist per row inside a single transaction, as synchronizer does
+        auto start = std::chrono::steady_clock::now();
+        {
+            database::transaction transaction(*db);
+            for(size_t i = 0; i < rows; i++)
+            {
+                auto f = std::make_unique<field>();
+                f->group_id = static_cast<int64_t>(i % 100) + 1;
+                f->title = "title " + std::to_string(i);
+                f->value = "value " + std::to_string(i);
+                dao.persist<field>(f, false);
+            }
+            transaction.commit();
+        }
+        auto apply = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        auto all = dao.get_all<field>();
+        auto get_all = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        EXPECT_EQ(all.size(), rows);
+
+        std::cout << name << " x" << rows << " sync apply: " << apply << "ms get_all: " << get_all << "ms" << std::endl;
+    }
+}
+
+TEST_F(DatabaseServiceTest, MaintenanceCheckpointsAndVacuums)
+{
+    ASSERT_TRUE(db->open(test_db_path));
+
+    auto auto_vacuum = db->execute("PRAGMA auto_vacuum");
+    ASSERT_TRUE(auto_vacuum.has_value());
+    EXPECT_EQ(auto_vacuum.value()->at(0).at(0).to_integer(), 2); // INCREMENTAL
+
+    maintenance::options options;
+    options.tick = std::chrono::milliseconds(20);
+    options.idle_after = std::chrono::milliseconds(100);
+    options.checkpoint_pages = 10;
+    options.vacuum_threshold_pages = 1;
+    options.vacuum_slice_pages = 1'000;
+    db->start_maintenance(options);
+    ASSERT_NE(db->get_maintenance(), nullptr);
+
+    {
+        database::transaction transaction(*db);
+        std::string value(1'024, 'x');
+        for(int i = 0; i < 500; i++)
+        {
+            db->update("INSERT INTO fields (title, value, is_hidden) VALUES (?, ?, 0)", {variant(std::to_string(i)), variant(value)});
+        }
+        transaction.commit();
+    }
+    db->update("DELETE FROM fields");
+    EXPECT_GT(db->get_maintenance()->get_metrics().freelist_pages, 0);
+
+    // Wait for the idle TRUNCATE checkpoint and the vacuum slices
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    maintenance::metrics metrics;
+    do
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        metrics = db->get_maintenance()->get_metrics();
+    }
+    while((metrics.freelist_pages > 0 || metrics.wal_size > 0) && std::chrono::steady_clock::now() < deadline);
+
+    EXPECT_EQ(metrics.freelist_pages, 0);
+    EXPECT_EQ(metrics.wal_size, 0);
+    EXPECT_GT(metrics.truncate_checkpoints, 0);
+    EXPECT_GT(metrics.vacuumed_pages, 0);
+
+    // The metrics do not wait for a write transaction of another thread
+    std::promise<void> started, finish;
+    std::thread writer([&]
+    {
+        database::transaction transaction(*db);
+        db->update("INSERT INTO fields (title, value, is_hidden) VALUES ('writer', 'value', 0)");
+        started.set_value();
+        finish.get_future().wait();
+        transaction.rollback();
+    });
+    started.get_future().wait();
+    auto pending = std::async(std::launch::async, [this] { return db->get_maintenance()->get_metrics(); });
+    EXPECT_EQ(pending.wait_for(std::chrono::seconds(2)), std::future_status::ready);
+    finish.set_value();
+    writer.join();
+
+    db->stop_maintenance();
+    EXPECT_EQ(db->get_maintenance(), nullptr);
+}
+
+TEST_F(DatabaseServiceTest, MigrationsReachLastVersion)
+{
+    ASSERT_TRUE(db->open(test_db_path));
+    EXPECT_EQ(migrator(*db).get_version(), migrator::get_migrations().back().version);
+
+    // A failing migration rolls back together with its version bump
+    std::vector<migration> migrations = {
+        {migrator::get_migrations().back().version + 1, "ok", "CREATE TABLE migration_ok (id INTEGER)"},
+        {migrator::get_migrations().back().version + 2, "broken", "CREATE TABLE migration_broken (id INTEGER); INSERT INTO missing VALUES (1)"},
+    };
+    EXPECT_THROW(migrator(*db).migrate(migrations), std::runtime_error);
+    EXPECT_EQ(migrator(*db).get_version(), migrator::get_migrations().back().version + 1);
+
+    auto tables = db->execute("SELECT name FROM sqlite_master WHERE type = 'table' AND name LIKE 'migration_%'");
+    ASSERT_TRUE(tables.has_value());
+    ASSERT_EQ(tables.value()->size(), 1);
+    EXPECT_EQ(tables.value()->at(0)["name"].to_text(), "migration_ok");
+}
+
+TEST_F(DatabaseServiceTest, DaoQueryPlansUseIndexes)
+{
+    ASSERT_TRUE(db->open(test_db_path));
+
+    auto plan = [this](const std::string& sql, const database::parameters& params)
+    {
+        std::string ret;
+        auto result = db->execute("EXPLAIN QUERY PLAN " + sql, params);
+        EXPECT_TRUE(result.has_value());
+        for(auto&& row : *result.value())
+        {
+            ret += row["detail"].to_text() + "\n";
+        }
+        return ret;
+    };
+
+    auto check = [&]<typename T>(std::type_identity<T>)
+    {
+        using table = pocket::daos::sqlite_table<T>;
+        const std::string name(pocket::daos::table_descriptor<T>::name);
+
+        // dao::get_all(group_id), either group_id index keeps the rows in id order
+        auto query = table::get_all_query(1, false);
+        auto detail = plan(query.sql(), query.parameters());
+        EXPECT_NE(detail.find("SEARCH " + name + " USING INDEX " + name + "_"), std::string::npos) << detail;
+        EXPECT_NE(detail.find("(group_id=?"), std::string::npos) << detail;
+        EXPECT_EQ(detail.find("TEMP B-TREE"), std::string::npos) << detail;
+
+        // dao::get_all()
+        query = table::get_all_query(-1, false);
+        detail = plan(query.sql(), query.parameters());
+        EXPECT_NE(detail.find("USING INDEX " + name + "_live"), std::string::npos) << detail;
+        EXPECT_EQ(detail.find("TEMP B-TREE"), std::string::npos) << detail;
+
+        // dao::get_all(NO_ID, true), collect_data_table of the synchronizer
+        query = table::get_all_query(-1, true);
+        detail = plan(query.sql(), query.parameters());
+        EXPECT_NE(detail.find("USING INDEX " + name + "_not_synchronized"), std::string::npos) << detail;
+        EXPECT_EQ(detail.find("TEMP B-TREE"), std::string::npos) << detail;
+
+        // dao::get
+        detail = plan(std::string(pocket::daos::table_sql<T>::select_by_id.view()), {variant(1)});
+        EXPECT_NE(detail.find("USING INTEGER PRIMARY KEY (rowid=?)"), std::string::npos) << detail;
+
+        // dao::del_by_group_id
+        detail = plan("UPDATE " + name + " SET deleted = 1, synchronized = 0 WHERE group_id = ?", {variant(1)});
+        EXPECT_NE(detail.find("USING INDEX " + name + "_group_id (group_id=?)"), std::string::npos) << detail;
+
+        // dao::rm_by_group_id
+        detail = plan("DELETE FROM " + name + " WHERE deleted = 1 AND group_id = ?", {variant(1)});
+        EXPECT_NE(detail.find("USING INDEX " + name + "_group_id (group_id=? AND deleted=?)"), std::string::npos) << detail;
+    };
+    check(std::type_identity<group>{});
+    check(std::type_identity<group_field>{});
+    check(std::type_identity<field>{});
+
+    // dao_user::login
+    auto detail = plan("SELECT * FROM user WHERE email = ? AND passwd = ?", {variant(1)});
+    EXPECT_NE(detail.find("USING INDEX user_email (email=?)"), std::string::npos) << detail;
+}
+
+TEST_F(DatabaseServiceTest, SnapshotAndRestore)
+{
+    ASSERT_TRUE(db->open(test_db_path));
+    auto snapshot_path = test_db_path + ".snapshot";
+
+    {
+        database::transaction transaction(*db);
+        std::string value(512, 'x');
+        for(int i = 0; i < 2'000; i++)
+        {
+            db->update("INSERT INTO fields (title, value, is_hidden) VALUES (?, ?, 0)", {variant(std::to_string(i)), variant(value)});
+        }
+        transaction.commit();
+    }
+
+    // Writers keep going while the snapshot is taken a few pages at a time
+    std::atomic<bool> done = false;
+    std::atomic<int> written = 0;
+    std::thread writer([this, &done, &written]
+    {
+        while(!done)
+        {
+            db->update("INSERT INTO fields (title, value, is_hidden) VALUES ('concurrent', 'x', 0)");
+            written++;
+        }
+    });
+
+    int steps = 0;
+    EXPECT_TRUE(db->snapshot_to(snapshot_path, 8, [&steps](int, int) { steps++; }));
+    done = true;
+    writer.join();
+    EXPECT_GT(steps, 1);
+    EXPECT_GT(written, 0);
+    ASSERT_TRUE(std::filesystem::exists(snapshot_path));
+    EXPECT_FALSE(std::filesystem::exists(snapshot_path + ".tmp"));
+
+    auto count = [this]
+    {
+        auto result = db->execute("SELECT COUNT(*) FROM fields");
+        EXPECT_TRUE(result.has_value());
+        return result.value()->at(0).at(0).to_integer();
+    };
+    auto before = count();
+
+    db->update("DELETE FROM fields");
+    EXPECT_EQ(count(), 0);
+
+    EXPECT_TRUE(db->restore_from(snapshot_path));
+    auto restored = count();
+    EXPECT_GE(restored, 2'000);
+    EXPECT_LE(restored, before);
+    EXPECT_EQ(migrator(*db).get_version(), migrator::get_migrations().back().version);
+
+    std::filesystem::remove(snapshot_path);
+}
+
+TEST_F(DatabaseServiceTest, BorrowedParametersBindWithoutCopies)
+{
+    ASSERT_TRUE(db->open(test_db_path));
+
+    database::parameters small = {variant(1), variant("a"), variant(2.0)};
+    EXPECT_TRUE(small.is_inline());
+    auto moved = std::move(small);
+    EXPECT_EQ(moved.size(), 3);
+    EXPECT_EQ(moved[1].to_text(), "a");
+
+    database::parameters wide;
+    for(int i = 0; i < 20; i++)
+    {
+        wide.emplace_back(i);
+    }
+    EXPECT_FALSE(wide.is_inline());
+    EXPECT_EQ(wide.at(19).to_integer(), 19);
+
+    // A large note bound by view must round trip byte for byte, embedded NUL included
+    std::string note(1 << 20, 'n');
+    note[10] = '\0';
+    db->update("INSERT INTO fields (title, value, is_hidden) VALUES (?, ?, 0)", {variant::view("note"), variant::view(note)});
+
+    auto result = db->execute("SELECT value, length(CAST(value AS BLOB)) AS size FROM fields WHERE title = ?", {variant::view("note")});
+    ASSERT_TRUE(result.has_value());
+    ASSERT_EQ(result.value()->size(), 1);
+    EXPECT_EQ(result.value()->at(0)["size"].to_integer(), note.size());
+    EXPECT_EQ(result.value()->at(0)["value"].to_text(), note);
+
+    // NULL variants keep binding as empty text
+    db->update("INSERT INTO fields (title, value, is_hidden) VALUES ('empty', ?, 0)", {variant(nullptr)});
+    auto empty = db->execute("SELECT typeof(value) AS t FROM fields WHERE title = 'empty'");
+    ASSERT_TRUE(empty.has_value());
+    EXPECT_EQ(empty.value()->at(0)["t"].to_text(), "text");
+}
+
+TEST_F(DatabaseServiceTest, CiphertextStorageRaw)
+{
+    ASSERT_TRUE(db->open(test_db_path));
+    EXPECT_EQ(db->get_ciphertext_storage(), database::ciphertext_storage::BASE64);
+    pocket::daos::dao dao(db);
+
+    const std::string iv = "0123456789abcdef";
+    const std::string plain(300, 'p');
+    aes base64(iv, "secret");
+
+    auto f = std::make_unique<field>();
+    f->group_id = 1;
+    f->title = base64.encrypt("title");
+    f->value = base64.encrypt(plain);
+    const auto base64_value = f->value;
+    auto id = dao.persist<field>(f, false);
+    ASSERT_GT(id, 0);
+
+    auto type_and_size = [this](int64_t id)
+    {
+        auto rs = db->execute("SELECT typeof(value) AS t, length(CAST(value AS BLOB)) AS size FROM fields WHERE id = ?", {variant(id)});
+        EXPECT_TRUE(rs.has_value() && rs.value()->size() == 1);
+        return std::pair{rs.value()->at(0)["t"].to_text(), rs.value()->at(0)["size"].to_integer()};
+    };
+    auto [type, base64_size] = type_and_size(id);
+    EXPECT_EQ(type, "text");
+
+    // Existing rows are converted and the mode survives a reopen
+    db->set_ciphertext_storage(database::ciphertext_storage::RAW);
+    db->close();
+    ASSERT_TRUE(db->open(test_db_path));
+    ASSERT_TRUE(db->is_ciphertext_raw());
+
+    auto [raw_type, raw_size] = type_and_size(id);
+    EXPECT_EQ(raw_type, "blob");
+    EXPECT_LT(raw_size, base64_size);
+
+    aes raw(iv, "secret", true);
+    auto stored = dao.get<field>(id);
+    ASSERT_TRUE(stored.has_value());
+    EXPECT_EQ(raw.decrypt(stored.value()->value), plain);
+    EXPECT_EQ(raw.decrypt(stored.value()->title), "title");
+
+    // New rows are bound as BLOB
+    auto g = std::make_unique<field>();
+    g->group_id = 1;
+    g->title = raw.encrypt("other");
+    g->value = raw.encrypt(plain);
+    auto other = dao.persist<field>(g, false);
+    EXPECT_EQ(type_and_size(other).first, "blob");
+
+    // Back to base64 gives the original text
+    db->set_ciphertext_storage(database::ciphertext_storage::BASE64);
+    auto rs = db->execute("SELECT value FROM fields WHERE id = ?", {variant(id)});
+    ASSERT_TRUE(rs.has_value());
+    EXPECT_EQ(rs.value()->at(0)["value"].get_type(), variant::type::TEXT);
+    EXPECT_EQ(rs.value()->at(0)["value"].to_text(), base64_value);
+}
+
+TEST_F(DatabaseServiceTest, BusyHandlerBacksOffToDeadline)
+{
+    ASSERT_TRUE(db->open(test_db_path));
+    db->reset_busy_metrics();
+
+    // Another process holds the write lock
+    sqlite3* other = nullptr;
+    ASSERT_EQ(sqlite3_open(test_db_path.c_str(), &other), SQLITE_OK);
+    ASSERT_EQ(sqlite3_exec(other, "BEGIN IMMEDIATE", nullptr, nullptr, nullptr), SQLITE_OK);
+
+    // The call deadline, not the 3 s busy timeout, bounds the wait
+    auto start = std::chrono::steady_clock::now();
+    try
+    {
+        database::busy_deadline deadline(std::chrono::milliseconds(50));
+        db->update("INSERT INTO fields (title, value, is_hidden) VALUES ('busy', 'x', 0)");
+        FAIL() << "expected SQLITE_BUSY";
+    }
+    catch(const database_error& e)
+    {
+        EXPECT_TRUE(e.is_busy());
+        EXPECT_EQ(e.get_primary_code(), SQLITE_BUSY);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_GE(elapsed, std::chrono::milliseconds(45));
+    EXPECT_LT(elapsed, std::chrono::milliseconds(1'000));
+
+    auto metrics = db->get_busy_metrics();
+    EXPECT_EQ(metrics.events, 1);
+    EXPECT_EQ(metrics.timeouts, 1);
+    EXPECT_GT(metrics.retries, 3);
+    EXPECT_GE(metrics.wait, std::chrono::milliseconds(40));
+
+    // Released while waiting: the statement goes through
+    std::thread releaser([other]
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        sqlite3_exec(other, "COMMIT", nullptr, nullptr, nullptr);
+    });
+    EXPECT_GT(db->update("INSERT INTO fields (title, value, is_hidden) VALUES ('busy', 'x', 0)"), 0);
+    releaser.join();
+    sqlite3_close(other);
+
+    metrics = db->get_busy_metrics();
+    EXPECT_EQ(metrics.events, 2);
+    EXPECT_EQ(metrics.timeouts, 1);
+}
+
+TEST_F(DatabaseServiceTest, MemoryStorageMatchesSqlite)
+{
+    ASSERT_TRUE(db->open(test_db_path));
+    pocket::daos::memory_storage memory;
+    pocket::daos::dao on_disk(db);
+    pocket::daos::dao in_memory(memory);
+
+    for(auto dao : {&on_disk, &in_memory})
+    {
+        auto parent = std::make_unique<group>();
+        parent->title = "parent";
+        parent->server_id = 100;
+        auto parent_id = dao->persist<group>(parent, false);
+        ASSERT_EQ(parent_id, 1);
+
+        auto child = std::make_unique<group>();
+        child->title = "child";
+        child->group_id = parent_id;
+        ASSERT_EQ(dao->persist<group>(child, false), 2);
+
+        for(int i = 0; i < 6; i++)
+        {
+            auto f = std::make_unique<field>();
+            f->group_id = i % 2 ? parent_id : 2;
+            f->title = "field " + std::to_string(i);
+            f->server_id = 200 + i;
+            f->synchronized = i != 3;
+            ASSERT_EQ(dao->persist<field>(f, false), i + 1);
+        }
+
+        // Update moves field 1 to group 2
+        auto moved = dao->get<field>(1).value();
+        moved->group_id = 2;
+        moved->value = "moved";
+        EXPECT_EQ(dao->persist<field>(moved, false), 1);
+
+        EXPECT_GT(dao->del<field>(4), 0);
+        EXPECT_EQ(dao->get_by_server_id<group>(100).value()->title, "parent");
+        EXPECT_EQ(dao->get_by_server_id<field>(205).value()->id, 6);
+        EXPECT_FALSE(dao->get_by_server_id<field>(999).has_value());
+
+        auto groups = dao->get_all<group>();
+        ASSERT_EQ(groups.size(), 2);
+        EXPECT_EQ(groups[0]->title, "parent");
+
+        auto ids = [](auto&& list)
+        {
+            std::vector<int64_t> ret;
+            for(auto&& it : list)
+            {
+                ret.push_back(it->id);
+            }
+            return ret;
+        };
+        EXPECT_EQ(ids(dao->get_all<field>(parent_id)), (std::vector<int64_t>{2, 6}));
+        EXPECT_EQ(ids(dao->get_all<field>(2)), (std::vector<int64_t>{1, 3, 5}));
+        EXPECT_EQ(ids(dao->get_all<field>(-1, true)), (std::vector<int64_t>{4}));
+        EXPECT_EQ(dao->get<field>(1).value()->value, "moved");
+
+        EXPECT_GT(dao->rm<field>(2), 0);
+        EXPECT_GT(dao->rm_by_group_id<field>(parent_id), 0);
+        EXPECT_EQ(ids(dao->get_all<field>(parent_id)), (std::vector<int64_t>{6}));
+        EXPECT_FALSE(dao->get<field>(4).has_value());
+        EXPECT_EQ(dao->get_last_id<field>(), 6);
+    }
+
+    // Only rows not deleted yet are counted, the highest id left after removing the last one
+    for(int i = 0; i < 3; i++)
+    {
+        auto f = std::make_unique<field>();
+        f->group_id = 9;
+        f->title = "counted";
+        in_memory.persist<field>(f, false);
+    }
+    EXPECT_EQ(in_memory.get_last_id<field>(), 9);
+    EXPECT_EQ(in_memory.del<field>(7), 1);
+    EXPECT_EQ(in_memory.del_by_group_id<field>(9), 2);
+    EXPECT_EQ(in_memory.del_all<field>(), 4);
+    EXPECT_EQ(in_memory.del_all<field>(), 0);
+    EXPECT_EQ(in_memory.rm<field>(9), 1);
+    EXPECT_EQ(in_memory.get_last_id<field>(), 8);
+}
+
+TEST_F(DatabaseServiceTest, MemoryStorageBenchmark)
+{
+    auto env_rows = benchmark_rows();
+    if(!env_rows)
+    {
+        GTEST_SKIP() << "POCKET_BENCHMARK_ROWS not set";
+    }
+    const size_t rows = *env_rows;
+    ASSERT_TRUE(db->open(test_db_path));
+
+    pocket::daos::memory_storage memory;
+    pocket::daos::dao on_disk(db);
+    pocket::daos::dao in_memory(memory);
+
+    for(auto [name, dao] : {std::pair{"sqlite", &on_disk}, std::pair{"memory", &in_memory}})
+    {
+        auto start = std::chrono::steady_clock::now();
+        {
+            database::transaction transaction(*db);
+            for(size_t i = 0; i < rows; i++)
+            {
+                auto f = std::make_unique<field>();
+                f->group_id = static_cast<int64_t>(i % 100) + 1;
+                f->title = "title " + std::to_string(i);
+                dao->persist<field>(f, false);
+            }
+            transaction.commit();
+        }
+        auto persist = std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        size_t read = 0;
+        for(int64_t group_id = 1; group_id <= 100; group_id++)
+        {
+            read += dao->get_all<field>(group_id).size();
+        }
+        auto get_all = std::chrono::steady_clock::now() - start;
+        EXPECT_EQ(read, rows);
+
+        std::cout << name << " persist x" << rows << ": " << std::chrono::duration_cast<std::chrono::microseconds>(persist).count()
+                  << "us get_all by group x100: " << std::chrono::duration_cast<std::chrono::microseconds>(get_all).count() << "us" << std::endl;
+    }
+}
+
+TEST_F(DatabaseServiceTest, EncryptedDatabaseAtRest)
+{
+    database::open_options options;
+    options.encryption_key = "correct horse battery staple";
+    ASSERT_TRUE(db->open(test_db_path, options));
+    EXPECT_TRUE(crypto_vfs::has_key(test_db_path));
+    auto snapshot_path = test_db_path + ".snapshot";
+
+    const std::string marker = "PLAINTEXT-MARKER-";
+    {
+        database::transaction transaction(*db);
+        for(int i = 0; i < 500; i++)
+        {
+            db->update("INSERT INTO fields (title, value, is_hidden) VALUES (?, ?, 0)", {variant(marker + std::to_string(i)), variant(std::string(300, 'm'))});
+        }
+        transaction.commit();
+    }
+
+    auto count = [&marker](database& database)
+    {
+        auto result = database.execute("SELECT COUNT(*) FROM fields WHERE title LIKE ?", {variant(marker + "%")});
+        EXPECT_TRUE(result.has_value());
+        return result.value()->at(0).at(0).to_integer();
+    };
+    auto in_clear = [&marker](const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        return content.find(marker) != std::string::npos || content.find(std::string(64, 'm')) != std::string::npos;
+    };
+
+    // Read pool connections decrypt through the same VFS
+    EXPECT_EQ(count(*db), 500);
+    EXPECT_TRUE(db->snapshot_to(snapshot_path));
+
+    EXPECT_FALSE(in_clear(test_db_path));
+    EXPECT_FALSE(in_clear(test_db_path + "-wal"));
+    EXPECT_FALSE(in_clear(snapshot_path));
+    db->close();
+    EXPECT_FALSE(in_clear(test_db_path));
+
+    {
+        database reopened;
+        ASSERT_TRUE(reopened.open(test_db_path, options));
+        EXPECT_EQ(count(reopened), 500);
+        reopened.update("DELETE FROM fields");
+        EXPECT_TRUE(reopened.restore_from(snapshot_path));
+        EXPECT_EQ(count(reopened), 500);
+        reopened.close();
+    }
+
+    // A wrong key must not be taken for a new database
+    auto wrong = options;
+    wrong.encryption_key = "wrong";
+    {
+        database other;
+        EXPECT_THROW(other.open(test_db_path, wrong), std::runtime_error);
+    }
+    {
+        database plain;
+        EXPECT_THROW(plain.open(test_db_path), std::runtime_error);
+    }
+    EXPECT_GT(std::filesystem::file_size(test_db_path), 0);
+
+    ASSERT_TRUE(db->open(test_db_path, options));
+    EXPECT_EQ(count(*db), 500);
+
+    crypto_vfs::remove_key(snapshot_path);
+    std::filesystem::remove(snapshot_path);
+}
+
+TEST_F(DatabaseServiceTest, EncryptedWalNeverReusesKeystream)
+{
+    // Two generations of the WAL, parted by a checkpoint, rewrite the page of the same row at the same offset
+    auto generations = [](database& handle, const std::string& path)
+    {
+        auto write = [&](char c)
+        {
+            handle.update("UPDATE fields SET value = ? WHERE id = 1", {variant(std::string(1'000, c))});
+            std::ifstream file(path + "-wal", std::ios::binary);
+            return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        };
+        handle.update("INSERT INTO fields (title, value, is_hidden) VALUES ('title', 'value', 0)");
+        write('a');
+        EXPECT_TRUE(handle.checkpoint(database::checkpoint_mode::TRUNCATE));
+        auto first = write('b');
+        EXPECT_TRUE(handle.checkpoint(database::checkpoint_mode::RESTART));
+        return std::pair{first, write('a')};
+    };
+    auto xor_of = [](const std::string& a, const std::string& b, size_t from)
+    {
+        std::string ret;
+        for(size_t i = from; i < std::min(a.size(), b.size()); i++)
+        {
+            ret += static_cast<char>(a[i] ^ b[i]);
+        }
+        return ret;
+    };
+    constexpr size_t FIRST_PAGE = 32 + 24; // WAL header, frame header
+
+    // Plaintext difference of the two generations, the pages are the same with or without encryption
+    std::string plain_xor;
+    auto plain_path = test_db_path + ".plain";
+    {
+        database plain;
+        ASSERT_TRUE(plain.open(plain_path));
+        auto [first, second] = generations(plain, plain_path);
+        ASSERT_EQ(first.size(), second.size());
+        ASSERT_GT(first.size(), FIRST_PAGE);
+        plain_xor = xor_of(first, second, FIRST_PAGE);
+        EXPECT_NE(plain_xor.find_first_not_of('\0'), std::string::npos);
+        plain.close();
+    }
+    std::filesystem::remove(plain_path);
+
+    // With a reused keystream the XOR of the ciphertexts would be the XOR of the plaintexts
+    database::open_options options;
+    options.encryption_key = "correct horse battery staple";
+    ASSERT_TRUE(db->open(test_db_path, options));
+    auto [first, second] = generations(*db, test_db_path);
+    ASSERT_EQ(first.size(), second.size());
+    EXPECT_NE(first.substr(0, crypto_vfs::NONCE_SIZE), second.substr(0, crypto_vfs::NONCE_SIZE));
+    auto cipher_xor = xor_of(first, second, crypto_vfs::NONCE_SIZE + FIRST_PAGE);
+    ASSERT_EQ(cipher_xor.size(), plain_xor.size());
+    size_t same = 0;
+    for(size_t i = 0; i < cipher_xor.size(); i++)
+    {
+        same += cipher_xor[i] == plain_xor[i];
+    }
+    EXPECT_LT(same, cipher_xor.size() / 64);
+
+    auto result = db->execute("SELECT value FROM fields WHERE id = 1");
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result.value()->at(0).at(0).to_text(), std::string(1'000, 'a'));
+}
+
+TEST_F(DatabaseServiceTest, IoStatsPerTag)
+{
+    database::open_options options;
+    options.io_stats = true;
+    options.mmap_size = 0;
+    ASSERT_TRUE(db->open(test_db_path, options));
+    db->reset_io_stats();
+
+    {
+        database::io_tag tag("test.insert");
+        database::transaction transaction(*db);
+        for(int i = 0; i < 200; i++)
+        {
+            db->update("INSERT INTO fields (title, value, is_hidden) VALUES (?, ?, 0)", {variant(std::to_string(i)), variant(std::string(200, 'x'))});
+        }
+        transaction.commit();
+    }
+    {
+        database::io_tag tag("test.select");
+        auto result = db->execute("SELECT COUNT(*) FROM fields WHERE value LIKE 'x%'");
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(result.value()->at(0).at(0).to_integer(), 200);
+    }
+
+    auto&& stats = db->io_stats();
+    using call = io_monitor::call;
+    ASSERT_TRUE(stats.contains("test.insert"));
+    ASSERT_TRUE(stats.contains("test.select"));
+
+    auto&& writes = stats.at("test.insert")[static_cast<size_t>(call::WRITE)];
+    EXPECT_GT(writes.calls, 0);
+    EXPECT_GE(writes.bytes, 200 * 200);
+    EXPECT_GT(writes.time.count(), 0);
+    uint64_t in_histogram = 0;
+    for(auto&& it : writes.histogram)
+    {
+        in_histogram += it;
+    }
+    EXPECT_EQ(in_histogram, writes.calls);
+    EXPECT_GT(stats.at("test.insert")[static_cast<size_t>(call::SYNC)].calls, 0);
+
+    // The read pool connection opened in scope reads schema and pages
+    EXPECT_GT(stats.at("test.select")[static_cast<size_t>(call::READ)].bytes, 0);
+    EXPECT_EQ(stats.at("test.select")[static_cast<size_t>(call::WRITE)].calls, 0);
+
+    db->reset_io_stats();
+    EXPECT_TRUE(db->io_stats().empty());
+}
+
+TEST_F(DatabaseServiceTest, ViewListFiltersAndPagesInSql)
+{
+    ASSERT_TRUE(db->open(test_db_path));
+    auto u = std::make_unique<user>();
+    u->passwd = "secret";
+    pocket::views::view<field> fields(u, db, "0123456789abcdef");
+
+    for(int i = 0; i < 40; i++)
+    {
+        auto f = std::make_unique<field>();
+        f->group_id = 7;
+        f->title = (i % 2 ? "Alpha " : "beta ") + std::to_string(100 + i);
+        f->value = "value";
+        ASSERT_GT(fields.persist(f), 0);
+    }
+
+    // Stored encrypted, SQLite only sees plaintext through pocket_decrypt()
+    auto count = [this](std::string query)
+    {
+        auto result = db->execute(std::move(query));
+        EXPECT_TRUE(result.has_value());
+        return result.value()->at(0).at(0).to_integer();
+    };
+    EXPECT_EQ(count("SELECT COUNT(*) FROM fields WHERE title LIKE '%lpha%'"), 0);
+    EXPECT_EQ(count("SELECT COUNT(*) FROM fields WHERE instr(pocket_fold(pocket_decrypt(title)), 'alpha') > 0"), 20);
+
+    auto&& all = fields.get_list(7);
+    ASSERT_EQ(all.size(), 40);
+    EXPECT_EQ(all.front()->title, "Alpha 101");
+    EXPECT_EQ(all.front()->value, "value");
+    EXPECT_TRUE(std::is_sorted(all.begin(), all.end(), [](auto& a, auto& b) { return a->title < b->title; }));
+
+    auto&& alpha = fields.get_list(7, "ALPHA");
+    ASSERT_EQ(alpha.size(), 20);
+    for(auto&& it : alpha)
+    {
+        EXPECT_TRUE(it->title.starts_with("Alpha"));
+    }
+
+    auto&& page = fields.get_list(7, "alpha", 5, 10);
+    ASSERT_EQ(page.size(), 5);
+    EXPECT_EQ(page.front()->title, alpha[10]->title);
+    EXPECT_EQ(page.back()->title, alpha[14]->title);
+    EXPECT_TRUE(fields.get_list(7, "alpha", 5, 20).empty());
+
+    // Bytes of UTF-8 sequences are left as they are
+    EXPECT_EQ(count("SELECT pocket_fold('\xc3\x80LPHA') = '\xc3\x80lpha'"), 1);
+    EXPECT_TRUE(fields.get_list(7, "\xc3\x80LPHA").empty());
+
+    // Without a cipher pocket_decrypt() returns its argument
+    db->set_cipher(nullptr);
+    EXPECT_EQ(count("SELECT COUNT(*) FROM fields WHERE pocket_decrypt(title) = title"), 40);
+}
+
+TEST_F(DatabaseServiceTest, TableDescriptorsMatchSchema)
+{
+    using namespace pocket::daos;
+    static_assert(table_sql<field>::select.view().starts_with("SELECT id, server_id, user_id"));
+    static_assert(table_sql<group>::update.view().ends_with("timestamp_creation = ? WHERE id = ?"));
+
+    ASSERT_TRUE(db->open(test_db_path));
+
+    auto check = [this]<typename T>(std::type_identity<T>)
+    {
+        std::vector<std::string> schema;
+        db->query("PRAGMA table_info(" + std::string(table_descriptor<T>::name) + ")", {}, [&](const cursor& cursor)
+        {
+            schema.emplace_back(cursor.get_text("name"));
+            return true;
+        });
+        for_each_column<T>([&](auto&& column, size_t)
+        {
+            EXPECT_NE(std::find(schema.begin(), schema.end(), column.name), schema.end()) << column.name;
+        });
+    };
+    check(std::type_identity<group>{});
+    check(std::type_identity<group_field>{});
+    check(std::type_identity<field>{});
+
+    // Every column survives a round trip through the generated statements
+    pocket::daos::dao dao(db);
+    auto g = std::make_unique<group>();
+    g->server_id = 11;
+    g->user_id = 1;
+    g->group_id = 3;
+    g->server_group_id = 33;
+    g->title = "title";
+    g->icon = "icon";
+    g->note = "note";
+    g->synchronized = false;
+    g->timestamp_creation = 1234;
+    auto id = dao.persist<group>(g, true);
+    ASSERT_GT(id, 0);
+
+    auto stored = dao.get<group>(id);
+    ASSERT_TRUE(stored.has_value());
+    auto&& it = *stored.value();
+    EXPECT_EQ(it.server_id, 11);
+    EXPECT_EQ(it.group_id, 3);
+    EXPECT_EQ(it.server_group_id, 33);
+    EXPECT_EQ(it.title, "title");
+    EXPECT_EQ(it.icon, "icon");
+    EXPECT_EQ(it.note, "note");
+    EXPECT_FALSE(it.synchronized);
+    EXPECT_FALSE(it.deleted);
+    EXPECT_EQ(it.timestamp_creation, 1234);
+
+    it.note = "changed";
+    EXPECT_EQ(dao.persist<group>(stored.value(), false), id);
+    EXPECT_EQ(dao.get<group>(id).value()->note, "changed");
+}
+
+TEST_F(DatabaseServiceTest, PersistAllUpsertsInInputOrder)
+{
+    static_assert(pocket::daos::table_sql<group_field>::upsert_tail.view().ends_with("timestamp_creation = excluded.timestamp_creation RETURNING id"));
+
+    ASSERT_TRUE(db->open(test_db_path));
+    pocket::daos::memory_storage memory;
+    pocket::daos::dao on_disk(db);
+    pocket::daos::dao in_memory(memory);
+
+    for(auto dao : {&on_disk, &in_memory})
+    {
+        auto existing = std::make_unique<field>();
+        existing->group_id = 1;
+        existing->title = "existing";
+        auto existing_id = dao->persist<field>(existing, false);
+        ASSERT_GT(existing_id, 0);
+
+        pocket::daos::dao::list<field> rows;
+        for(auto title : {"first", "existing", "second", "given", "third"})
+        {
+            auto f = std::make_unique<field>();
+            f->group_id = 1;
+            f->title = title;
+            rows.push_back(std::move(f));
+        }
+        rows[1]->id = existing_id;
+        rows[3]->id = existing_id + 1000;
+
+        auto ids = dao->persist_all<field>(rows);
+        ASSERT_EQ(ids.size(), rows.size());
+        for(size_t i = 0; i < rows.size(); i++)
+        {
+            EXPECT_EQ(rows[i]->id, ids[i]);
+            auto stored = dao->get<field>(ids[i]);
+            ASSERT_TRUE(stored.has_value());
+            EXPECT_EQ(stored.value()->title, rows[i]->title);
+        }
+        EXPECT_EQ(ids[1], existing_id);
+        EXPECT_EQ(ids[3], existing_id + 1000);
+        EXPECT_LT(ids[0], ids[2]);
+        EXPECT_LT(ids[2], ids[4]);
+        EXPECT_EQ(dao->get_all<field>(1).size(), 5);
+    }
+
+    // Wider than one statement and all or none
+    pocket::daos::dao::list<group_field> many;
+    for(int i = 0; i < 1'234; i++)
+    {
+        auto gf = std::make_unique<group_field>();
+        gf->group_id = 2;
+        gf->title = "gf " + std::to_string(i);
+        many.push_back(std::move(gf));
+    }
+    auto ids = on_disk.persist_all<group_field>(many);
+    EXPECT_EQ(std::set<int64_t>(ids.begin(), ids.end()).size(), many.size());
+    EXPECT_EQ(on_disk.get_all<group_field>(2).size(), many.size());
+    EXPECT_EQ(on_disk.get<group_field>(ids.back()).value()->title, "gf 1233");
+
+    db->execute("CREATE TEMP TRIGGER fail_upsert BEFORE INSERT ON group_fields WHEN NEW.title = '' BEGIN SELECT RAISE(ABORT, 'rejected'); END");
+    many.front()->id = 0;
+    many.back()->id = 0;
+    many.back()->title = std::string();
+    auto before = on_disk.get_last_id<group_field>();
+    EXPECT_THROW(on_disk.persist_all<group_field>(many), std::runtime_error);
+    EXPECT_EQ(on_disk.get_last_id<group_field>(), before);
+    EXPECT_EQ(many.front()->id, 0);
+}
+
+TEST_F(DatabaseServiceTest, PersistAllBenchmark)
+{
+    // POCKET_BENCHMARK_ROWS=50000 for the reference run
+    auto env_rows = benchmark_rows();
+    if(!env_rows)
+    {
+        GTEST_SKIP() << "POCKET_BENCHMARK_ROWS not set";
+    }
+    const size_t rows = *env_rows;
+    ASSERT_TRUE(db->open(test_db_path));
+
+    auto make_rows = [rows](int64_t group_id)
+    {
+        pocket::daos::dao::list<field> ret;
+        ret.reserve(rows);
+        for(size_t i = 0; i < rows; i++)
+        {
+            auto f = std::make_unique<field>();
+            f->group_id = group_id;
+            f->title = "title " + std::to_string(i);
+            f->value = "value " + std::to_string(i);
+            ret.push_back(std::move(f));
+        }
+        return ret;
+    };
+
+    pocket::daos::dao dao(db);
+    auto one_by_one = make_rows(1);
+    auto start = std::chrono::steady_clock::now();
+    for(auto&& f : one_by_one)
+    {
+        f->id = dao.persist<field>(f, false);
+    }
+    auto persist = std::chrono::steady_clock::now() - start;
+
+    auto bulk = make_rows(2);
+    start = std::chrono::steady_clock::now();
+    auto ids = dao.persist_all<field>(bulk);
+    auto persist_all = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(ids.size(), rows);
+    EXPECT_EQ(dao.get_all<field>(2).size(), rows);
+
+    // Same rows again: every one is an update
+    start = std::chrono::steady_clock::now();
+    dao.persist_all<field>(bulk);
+    auto upsert_all = std::chrono::steady_clock::now() - start;
+    EXPECT_EQ(dao.get_all<field>(2).size(), rows);
+
+    using std::chrono::duration_cast, std::chrono::microseconds;
+    std::cout << "persist x" << rows << ": " << duration_cast<microseconds>(persist).count()
+              << "us persist_all insert: " << duration_cast<microseconds>(persist_all).count()
+              << "us persist_all update: " << duration_cast<microseconds>(upsert_all).count() << "us" << std::endl;
+}
+
+TEST_F(DatabaseServiceTest, SelectQueryIsParameterized)
+{
+    using pocket::daos::select_query;
+
+    auto by_group = [](int64_t group_id)
+    {
+        return select_query<field>().deleted(false).group_id(group_id).order_by("group_id").order_by("id");
+    };
+    EXPECT_EQ(by_group(1).sql(), by_group(2).sql());
+    EXPECT_TRUE(by_group(1).sql().ends_with(" FROM fields WHERE deleted = 0 AND group_id = ? ORDER BY group_id, id"));
+    EXPECT_EQ(by_group(7).parameters().size(), 1);
+    EXPECT_EQ(by_group(7).parameters()[0].to_integer(), 7);
+    EXPECT_THROW(select_query<field>().order_by("id; DROP TABLE fields"), std::runtime_error);
+
+    ASSERT_TRUE(db->open(test_db_path));
+    pocket::daos::dao dao(db);
+    for(auto title : {"c", "a", "d", "b"})
+    {
+        auto f = std::make_unique<field>();
+        f->group_id = 5;
+        f->user_id = 1;
+        f->title = title;
+        f->value = "value";
+        dao.persist<field>(f, false);
+    }
+
+    auto query = select_query<field>().columns({"id", "title"}).user_id(1).group_id(5).order_by("title", true).limit(2, 1);
+    EXPECT_TRUE(query.sql().starts_with("SELECT id, title FROM fields WHERE user_id = ? AND group_id = ? ORDER BY title DESC LIMIT ? OFFSET ?"));
+
+    std::vector<std::string> titles;
+    pocket::daos::dao_read_write<field> dao_rw;
+    db->query(query.sql(), query.parameters(), [&](const cursor& cursor)
+    {
+        auto&& f = dao_rw.read(cursor);
+        EXPECT_TRUE(f->value.empty());
+        EXPECT_EQ(f->group_id, 0);
+        titles.push_back(f->title);
+        return true;
+    });
+    EXPECT_EQ(titles, (std::vector<std::string>{"c", "b"}));
+    EXPECT_EQ(dao.get_all<field>(5).size(), 4);
+}
+
+TEST_F(DatabaseServiceTest, SubtreeInThreeQueries)
+{
+    ASSERT_TRUE(db->open(test_db_path));
+    pocket::daos::memory_storage memory;
+    pocket::daos::dao on_disk(db);
+    pocket::daos::dao in_memory(memory);
+
+    for(auto dao : {&on_disk, &in_memory})
+    {
+        auto add_group = [dao](int64_t group_id, const char* title, bool deleted = false)
+        {
+            auto g = std::make_unique<group>();
+            g->group_id = group_id;
+            g->title = title;
+            g->deleted = deleted;
+            return dao->persist<group>(g, false);
+        };
+        auto add_rows = [dao](int64_t group_id, int count)
+        {
+            for(int i = 0; i < count; i++)
+            {
+                auto gf = std::make_unique<group_field>();
+                gf->group_id = group_id;
+                gf->title = "gf";
+                dao->persist<group_field>(gf, false);
+                auto f = std::make_unique<field>();
+                f->group_id = group_id;
+                f->title = "f";
+                dao->persist<field>(f, false);
+            }
+        };
+
+        auto a = add_group(0, "a");
+        auto b = add_group(a, "b");
+        auto c = add_group(b, "c");
+        auto d = add_group(a, "d", true);
+        auto e = add_group(d, "e");
+        auto x = add_group(0, "x");
+        add_rows(a, 1);
+        add_rows(b, 2);
+        add_rows(c, 3);
+        add_rows(e, 4);
+        add_rows(x, 5);
+
+        db->set_profiling(true);
+        db->reset_stats();
+        pocket::daos::subtree tree;
+        {
+            // The owner of a transaction reads on the writer connection, the one the profiler sees
+            database::transaction transaction(*db);
+            tree = dao->get_subtree(a);
+            transaction.commit();
+        }
+        if(dao == &on_disk)
+        {
+            uint64_t statements = 0;
+            for(auto&& it : db->stats())
+            {
+                statements += it.statement.starts_with("WITH RECURSIVE") ? it.count : 0;
+            }
+            EXPECT_EQ(statements, 3);
+        }
+
+        ASSERT_EQ(tree.children<group>(a).size(), 1);
+        EXPECT_EQ(tree.children<group>(a)[0]->title, "b");
+        ASSERT_EQ(tree.children<group>(b).size(), 1);
+        EXPECT_EQ(tree.children<group>(b)[0]->id, c);
+        EXPECT_TRUE(tree.children<group>(c).empty());
+        EXPECT_EQ(tree.children<group_field>(a).size(), 1);
+        EXPECT_EQ(tree.children<field>(b).size(), 2);
+        EXPECT_EQ(tree.children<field>(c).size(), 3);
+        EXPECT_TRUE(tree.children<field>(e).empty());
+        EXPECT_TRUE(tree.children<field>(x).empty());
+
+        auto&& vault = dao->get_subtree(0);
+        EXPECT_EQ(vault.children<group>(0).size(), 2);
+        EXPECT_EQ(vault.children<field>(x).size(), 5);
+    }
+}
+
+TEST_F(DatabaseServiceTest, CloneSubtreeInBulk)
+{
+    ASSERT_TRUE(db->open(test_db_path));
+    pocket::daos::memory_storage memory;
+    pocket::daos::dao on_disk(db);
+    pocket::daos::dao in_memory(memory);
+
+    for(auto dao : {&on_disk, &in_memory})
+    {
+        auto add_group = [dao](int64_t group_id, const char* title, int64_t server_id)
+        {
+            auto g = std::make_unique<group>();
+            g->group_id = group_id;
+            g->title = title;
+            g->server_id = server_id;
+            g->synchronized = true;
+            return dao->persist<group>(g, false);
+        };
+        auto a = add_group(0, "a", 10);
+        auto b = add_group(a, "b", 11);
+        auto x = add_group(0, "x", 12);
+
+        auto gf = std::make_unique<group_field>();
+        gf->group_id = a;
+        gf->title = "template";
+        gf->server_id = 20;
+        auto gf_id = dao->persist<group_field>(gf, false);
+        for(auto [group_id, title] : {std::pair{a, "in a"}, std::pair{b, "in b"}})
+        {
+            auto f = std::make_unique<field>();
+            f->group_id = group_id;
+            f->group_field_id = gf_id;
+            f->server_group_field_id = 20;
+            f->server_id = 30;
+            f->title = title;
+            f->synchronized = true;
+            dao->persist<field>(f, false);
+        }
+
+        auto copy = dao->clone_subtree(a, x, false);
+        ASSERT_GT(copy, 0);
+        EXPECT_EQ(dao->clone_subtree(a, 9'999, false), pocket::daos::dao::NO_ID);
+
+        auto&& root = dao->get<group>(copy).value();
+        EXPECT_EQ(root->title, "a");
+        EXPECT_EQ(root->group_id, x);
+        EXPECT_EQ(root->server_group_id, 12);
+        EXPECT_EQ(root->server_id, 0);
+        EXPECT_FALSE(root->synchronized);
+
+        auto&& tree = dao->get_subtree(copy);
+        ASSERT_EQ(tree.children<group>(copy).size(), 1);
+        auto copy_b = tree.children<group>(copy)[0]->id;
+        EXPECT_NE(copy_b, b);
+        EXPECT_EQ(tree.children<group>(copy)[0]->server_group_id, 0);
+        ASSERT_EQ(tree.children<group_field>(copy).size(), 1);
+        auto copy_gf = tree.children<group_field>(copy)[0]->id;
+        EXPECT_NE(copy_gf, gf_id);
+        ASSERT_EQ(tree.children<field>(copy_b).size(), 1);
+        auto&& f = tree.children<field>(copy_b)[0];
+        EXPECT_EQ(f->title, "in b");
+        EXPECT_EQ(f->group_field_id, copy_gf);
+        EXPECT_EQ(f->server_group_field_id, 0);
+        EXPECT_EQ(f->server_id, 0);
+        EXPECT_FALSE(f->synchronized);
+
+        // The originals are untouched by a copy, marked as deleted by a move
+        EXPECT_FALSE(dao->get<group>(a).value()->deleted);
+        auto moved = dao->clone_subtree(b, x, true);
+        ASSERT_GT(moved, 0);
+        EXPECT_TRUE(dao->get<group>(b).value()->deleted);
+        EXPECT_TRUE(dao->get_all<field>(b).empty());
+        EXPECT_EQ(dao->get_all<field>(moved).size(), 1);
+
+        // Into its own subtree: only what was there before the copy
+        auto nested = dao->clone_subtree(a, a, false);
+        ASSERT_GT(nested, 0);
+        EXPECT_EQ(dao->get_all<group>(a).size(), 1);
+        EXPECT_TRUE(dao->get_all<group>(nested).empty());
+
+        auto field_id = dao->get_all<field>(a)[0]->id;
+        auto field_copy = dao->clone_field(field_id, x, true);
+        ASSERT_GT(field_copy, 0);
+        EXPECT_EQ(dao->get<field>(field_copy).value()->group_id, x);
+        EXPECT_EQ(dao->get<field>(field_copy).value()->server_group_id, 12);
+        EXPECT_TRUE(dao->get_all<field>(a).empty());
+
+        // A deleted source is not copied again
+        EXPECT_EQ(dao->clone_field(field_id, x, false), pocket::daos::dao::NO_ID);
+    }
+}
+
+TEST_F(DatabaseServiceTest, CloneSubtreeBenchmark)
+{
+    // POCKET_BENCHMARK_ROWS=5000 for the reference run
+    auto env_rows = benchmark_rows();
+    if(!env_rows)
+    {
+        GTEST_SKIP() << "POCKET_BENCHMARK_ROWS not set";
+    }
+    const size_t rows = *env_rows;
+    ASSERT_TRUE(db->open(test_db_path));
+
+    pocket::daos::dao dao(db);
+    auto add_group = [&dao](int64_t group_id)
+    {
+        auto g = std::make_unique<group>();
+        g->group_id = group_id;
+        g->title = "group";
+        return dao.persist<group>(g, false);
+    };
+    auto src = add_group(0);
+    auto dst = add_group(0);
+    pocket::daos::dao::list<field> fields;
+    for(size_t i = 0; i < rows; i++)
+    {
+        auto f = std::make_unique<field>();
+        f->group_id = i % 10 ? src : add_group(src);
+        f->title = "title " + std::to_string(i);
+        fields.push_back(std::move(f));
+    }
+    dao.persist_all<field>(fields);
+
+    auto start = std::chrono::steady_clock::now();
+    auto moved = dao.clone_subtree(src, dst, true);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    ASSERT_GT(moved, 0);
+    auto&& tree = dao.get_subtree(moved);
+    size_t copied = tree.children<field>(moved).size();
+    for(auto&& g : tree.children<group>(moved))
+    {
+        copied += tree.children<field>(g->id).size();
+    }
+    EXPECT_EQ(copied, rows);
+    EXPECT_TRUE(dao.get_all<field>(src).empty());
+
+    std::cout << "clone_subtree move x" << rows << ": " << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() << "us" << std::endl;
+}
@@ -174,4 +174,41 @@ TEST_F(JsonServiceTest, EmptyJsonHandling)
     EXPECT_THROW({
         user usr = json_to_user(empty_json);
     }, std::runtime_error);
-}
\ No newline at end of file
+}
+
+TEST_F(JsonServiceTest, OpenOptionsParsing)
+{
+    auto defaults = json_to_open_options(R"({"userId": 1})");
+    EXPECT_TRUE(defaults.wal);
+    EXPECT_FALSE(defaults.cache_size_kib.has_value());
+
+    auto preset = json_to_open_options(R"({"database": "mobile_low_memory"})");
+    EXPECT_EQ(preset.read_pool_size, database::open_options::mobile_low_memory().read_pool_size);
+    EXPECT_EQ(preset.mmap_size, 0);
+
+    auto overridden = json_to_open_options(R"({"database": {"preset": "desktop_throughput", "mmapSize": 1048576, "synchronous": "FULL", "tempStore": "FILE"}})");
+    EXPECT_EQ(overridden.cache_size_kib, database::open_options::desktop_throughput().cache_size_kib);
+    EXPECT_EQ(overridden.mmap_size, 1048576);
+    EXPECT_EQ(overridden.synchronous, database::open_options::synchronous_mode::FULL);
+    EXPECT_EQ(overridden.temp_store_memory, false);
+
+    EXPECT_THROW(json_to_open_options(R"({"database": "unknown"})"), std::runtime_error);
+}
+
+TEST_F(JsonServiceTest, RawCiphertextIsBase64OnTheWire)
+{
+    auto f = std::make_unique<field>();
+    f->title = std::string("\x00\xff\x10", 3);
+    f->value = std::string("\x80\x81", 2);
+
+    auto j = serialize_json(f, false, true);
+    EXPECT_EQ(j["title"], "AP8Q");
+    EXPECT_EQ(j["value"], "gIE=");
+
+    auto back = json_to_field(j, false, true);
+    EXPECT_EQ(back.title, f->title);
+    EXPECT_EQ(back.value, f->value);
+
+    // Default keeps the stored text as is
+    EXPECT_EQ(serialize_json(f)["value"], f->value);
+}
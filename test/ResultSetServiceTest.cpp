@@ -22,10 +22,24 @@
 #include "pocket-services/result-set.hpp"
 #include "pocket-pods/variant.hpp"
 #include <filesystem>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
 
 using namespace pocket::services;
 using namespace pocket::pods;
 
+// Benchmarks only print timings, they run when POCKET_BENCHMARK_ROWS sets the number of iterations
+static std::optional<size_t> benchmark_rows()
+{
+    if(auto env = std::getenv("POCKET_BENCHMARK_ROWS"); env)
+    {
+        return std::stoul(env);
+    }
+    return std::nullopt;
+}
+
 class ResultSetServiceTest : public ::testing::Test 
 {
 protected:
@@ -183,4 +197,80 @@ TEST_F(ResultSetServiceTest, InvalidStatement)
     EXPECT_THROW({
         auto result_opt = db->execute("INVALID SQL QUERY");
     }, std::runtime_error);
-}
\ No newline at end of file
+}
+
+TEST_F(ResultSetServiceTest, ReturningExecutesOnce)
+{
+    auto result_opt = db->execute("INSERT INTO user (name, email, passwd) VALUES ('Test User 3', 'user3@example.com', 'x') RETURNING id, name");
+    ASSERT_TRUE(result_opt.has_value());
+
+    auto& result = *result_opt.value();
+    ASSERT_EQ(result.size(), 1);
+    EXPECT_EQ(result[0].find("name")->second.to_text(), "Test User 3");
+
+    auto count_opt = db->execute("SELECT COUNT(*) AS count FROM user WHERE email = 'user3@example.com'");
+    ASSERT_TRUE(count_opt.has_value());
+    EXPECT_EQ(count_opt.value()->at(0).find("count")->second.to_integer(), 1);
+}
+
+TEST_F(ResultSetServiceTest, RowsShareColumnSchema)
+{
+    auto result_opt = db->execute("SELECT id, name, email FROM user ORDER BY id");
+    ASSERT_TRUE(result_opt.has_value());
+
+    auto& result = *result_opt.value();
+    ASSERT_EQ(result.size(), 2);
+    EXPECT_EQ(result[0].get_schema(), result[1].get_schema());
+    ASSERT_EQ(result[0].size(), 3);
+
+    EXPECT_EQ(result[0].at(1).to_text(), "Test User 1");
+    EXPECT_EQ(result[1]["email"].to_text(), "user2@example.com");
+    EXPECT_EQ(result[1].find("missing"), result[1].end());
+    EXPECT_EQ(result[1]["missing"].get_type(), variant::type::NULL_T);
+
+    std::vector<std::string> names;
+    for (auto&& [name, value] : result[0]) {
+        names.push_back(name);
+    }
+    EXPECT_EQ(names, (std::vector<std::string>{"id", "name", "email"}));
+}
+
+TEST_F(ResultSetServiceTest, GetByIdBenchmark)
+{
+    // POCKET_BENCHMARK_ROWS=20000 for the reference run
+    auto env_iterations = benchmark_rows();
+    if(!env_iterations)
+    {
+        GTEST_SKIP() << "POCKET_BENCHMARK_ROWS not set";
+    }
+    const size_t iterations = *env_iterations;
+    static const std::string query = "SELECT * FROM user WHERE id = ?";
+
+    // result_set, as execute() returns it
+    int64_t rows = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < iterations; i++)
+    {
+        auto result_opt = db->execute(query, {variant(1)});
+        ASSERT_TRUE(result_opt.has_value());
+        rows += result_opt.value()->at(0)["id"].to_integer();
+    }
+    auto execute = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ(rows, static_cast<int64_t>(iterations));
+
+    // cursor, as the DAOs read a row by id
+    rows = 0;
+    start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < iterations; i++)
+    {
+        db->query(query, {variant(1)}, [&rows](const cursor& cursor)
+        {
+            rows += cursor.get_integer("id");
+            return false;
+        });
+    }
+    auto query_by_id = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ(rows, static_cast<int64_t>(iterations));
+
+    std::cout << "get by id x" << iterations << " execute: " << execute << "us query: " << query_by_id << "us" << std::endl;
+}
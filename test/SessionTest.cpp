@@ -22,6 +22,8 @@
 #include <filesystem>
 #include <thread>
 #include <chrono>
+#include <fstream>
+#include <iterator>
 
 #include "pocket-controllers/session.hpp"
 #include "pocket/tree.hpp"
@@ -305,6 +307,25 @@ TEST_F(SessionTest, SessionInit) try
     bool import_success = session.import_data(user, test_file, false);
     ASSERT_TRUE(import_success);
 
+    // With raw ciphertext storage the export without aes is the same base64 JSON, and imports back
+    using pocket::services::database;
+    auto read_file = [](const std::string& file_path)
+    {
+        std::ifstream file(file_path);
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    };
+    ASSERT_TRUE(session.export_data(user, test_file, false));
+    auto base64_export = read_file(test_file);
+
+    session.get_database()->set_ciphertext_storage(database::ciphertext_storage::RAW);
+    ASSERT_TRUE(session.export_data(user, test_file, false));
+    EXPECT_EQ(read_file(test_file), base64_export);
+
+    ASSERT_TRUE(session.import_data(user, test_file, false));
+    session.get_database()->set_ciphertext_storage(database::ciphertext_storage::BASE64);
+    ASSERT_TRUE(session.export_data(user, test_file, false));
+    EXPECT_EQ(read_file(test_file), base64_export);
+
 }
 catch (const std::exception& e)
 {
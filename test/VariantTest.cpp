@@ -219,4 +219,19 @@ TEST_F(VariantTest, BoundaryValues)
     variant v_max_int64(std::numeric_limits<int64_t>::max());
     EXPECT_EQ(v_max_int64.get_type(), variant::type::INT64);
     EXPECT_EQ(v_max_int64.to_integer(), std::numeric_limits<int64_t>::max());
-}
\ No newline at end of file
+}
+
+TEST_F(VariantTest, BorrowedView)
+{
+    std::string ciphertext(4096, 'c');
+    auto v = variant::view(ciphertext);
+    EXPECT_EQ(v.get_type(), variant::type::TEXT);
+    EXPECT_TRUE(v.is_borrowed());
+    EXPECT_EQ(v.to_text_view().data(), ciphertext.data());
+    EXPECT_EQ(v.to_text(), ciphertext);
+
+    variant owned(std::string("owned"));
+    EXPECT_FALSE(owned.is_borrowed());
+    EXPECT_EQ(owned.to_text_view(), "owned");
+    EXPECT_TRUE(variant(42).to_text_view().empty());
+}